@@ -0,0 +1,75 @@
+
+#include "benchmarks/common.h"
+#include <cmath>
+
+
+int main() {
+    const int imageWidth = 1280;
+    const int imageHeight = 720;
+    const int frames = 256;
+    // a single sample per frame, where the per frame overhead of accumulating matters most
+    const rt::Config config = {.sampleCount = 1, .bounceLimit = 5};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    auto scenes = createAllScenes(clObj.context, clObj.queue);
+    const auto& scene = scenes[7];
+
+    struct NamedFormat {
+        const char* name;
+        rt::Format format;
+    };
+    NamedFormat formats[] = {
+        {"RGBA32F", rt::Format::RGBA32F},
+        {"RGBA16F", rt::Format::RGBA16F},
+        {"RGBA8", rt::Format::RGBA8},
+    };
+
+    // every format renders the same frames (same seeds), so they only differ by the output conversion
+    std::vector<float> reference;
+    printf("\n%8s | %14s | %16s\n", "format", "ms per frame", "max error (/255)");
+    for (const NamedFormat& named : formats) {
+        rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, named.format, true);
+        raytracer.createClKernels(config);
+        raytracer.renderScene(scene, camera, config);
+
+        raytracer.resetFrameCount();
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < frames; i++) {
+            raytracer.renderScene(scene, camera, config);
+            raytracer.accumulatePixels();
+        }
+        double frameTime = getSecondsSince(startTime) / frames;
+
+        // in [0, 1], as floats
+        std::vector<float> pixels(imageWidth * imageHeight * 4);
+        std::vector<uint8_t> buffer(raytracer.getPixelBufferSize());
+        raytracer.readPixels(buffer.data());
+        for (size_t i = 0; i < pixels.size(); i++) {
+            if (named.format == rt::Format::RGBA8) {
+                pixels[i] = buffer[i] / 255.0f;
+            } else if (named.format == rt::Format::RGBA32F) {
+                pixels[i] = std::min(((float*) buffer.data())[i], 1.0f);
+            } else {
+                // half floats, positive and normal in this range
+                uint16_t bits = ((uint16_t*) buffer.data())[i];
+                float value = std::ldexp(1.0f + (bits & 0x3FF) / 1024.0f, ((bits >> 10) & 0x1F) - 15);
+                pixels[i] = bits == 0 ? 0.0f : std::min(value, 1.0f);
+            }
+        }
+        if (reference.empty()) {
+            reference = pixels;
+        }
+
+        float maxError = 0.0f;
+        for (size_t i = 0; i < pixels.size(); i++) {
+            maxError = std::max(maxError, std::abs(pixels[i] - reference[i]));
+        }
+        printf("%8s | %14.3f | %16.2f\n", named.name, frameTime * 1000, maxError * 255);
+    }
+}
@@ -0,0 +1,47 @@
+
+#include "benchmarks/common.h"
+
+
+int main() {
+    const int imageWidth = 1280;
+    const int imageHeight = 720;
+    const rt::Config config = {.sampleCount = 4, .bounceLimit = 5};
+    const float noiseThresholds[] = {0.05f, 0.02f};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, true);
+    raytracer.createClKernels(config);
+
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    auto scenes = createAllScenes(clObj.context, clObj.queue);
+    const int sceneIndices[] = {7, 8};
+
+    printf("\n%8s | %9s | %10s | %10s | %8s | %14s | %9s\n", "scene", "threshold", "sampling", "time (ms)", "frames", "pixel frames", "converged");
+    for (int sceneIdx : sceneIndices) {
+        for (float threshold : noiseThresholds) {
+            rt::AdaptiveSampling settings;
+            settings.noiseThreshold = threshold;
+            settings.maxFrames = 4096;
+
+            // a single tile covering the image renders every pixel until the noisiest one converges
+            rt::AdaptiveSampling uniform = settings;
+            uniform.tileSize = {imageWidth, imageHeight};
+
+            for (bool adaptive : {false, true}) {
+                rt::AdaptiveSamplingStats stats;
+                bool converged = raytracer.renderSceneAdaptive(scenes[sceneIdx], camera, config, adaptive ? settings : uniform, &stats);
+                printf(
+                    "%8d | %9.3f | %10s | %10.3f | %8u | %14llu | %9s\n",
+                    sceneIdx + 1, threshold, adaptive ? "adaptive" : "uniform", stats.time * 1000, stats.numFrames,
+                    (unsigned long long) stats.numPixelFrames, converged ? "yes" : "no"
+                );
+            }
+        }
+    }
+}
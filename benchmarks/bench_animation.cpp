@@ -0,0 +1,94 @@
+
+#include "benchmarks/common.h"
+#include "src/dynamic_scene.h"
+#include <cmath>
+
+
+// every object orbits the y axis (the inner ones faster, so that the bvh gets worse over time) and bobs up and down
+static rt::Object animateObject(const rt::Object& object, uint32_t objIdx, float time) {
+    glm::vec3 bob = {0.0f, 0.3f * sinf(time * 2.0f + objIdx * 0.1f), 0.0f};
+    auto move = [&](const cl_float3& v) {
+        glm::vec3 p = rt::toVec3(v);
+        float angle = time * 0.5f / (0.5f + sqrtf(p.x * p.x + p.z * p.z));
+        float c = cosf(angle), s = sinf(angle);
+        p = glm::vec3(c * p.x + s * p.z, p.y, c * p.z - s * p.x) + bob;
+        return cl_float3{p.x, p.y, p.z, v.s[3]};
+    };
+
+    rt::Object out = object;
+    if (auto sphere = std::get_if<rt::internal::Sphere>(&out.internal)) {
+        sphere->position = move(sphere->position);
+    } else if (auto triangle = std::get_if<rt::internal::Triangle>(&out.internal)) {
+        // moved as a whole, by the displacement of its first vertex
+        glm::vec3 offset = rt::toVec3(move(triangle->v0)) - rt::toVec3(triangle->v0);
+        for (cl_float3* v : {&triangle->v0, &triangle->v1, &triangle->v2}) {
+            *v = {v->s[0] + offset.x, v->s[1] + offset.y, v->s[2] + offset.z, v->s[3]};
+        }
+    }
+    return out;
+}
+
+
+int main() {
+    const int imageWidth = 640;
+    const int imageHeight = 360;
+    const int frames = 120;
+    const float frameTime = 1.0f / 30.0f;
+    const rt::Config config = {.sampleCount = 1, .bounceLimit = 2};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA8, false);
+    raytracer.createClKernels(config);
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 2, 8}, {0, -0.2f, -1});
+
+    NamedScene scenes[] = {
+        {"spheres 10k", createScene_sphereGrid(100)},
+        {"triangles 20k", createScene_triangleSoup(20'000)},
+        {"scene 8", createScene_8()},
+    };
+
+    printf("\n%16s | %18s | %18s | %10s | %10s\n", "scene", "rebuild (ms/frame)", "refit (ms/frame)", "rebuilds", "sah ratio");
+    for (const NamedScene& named : scenes) {
+        rt::Scene animated = named.scene;
+
+        // baseline: converting (and building the bvh for) every frame
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            for (uint32_t objIdx = 0; objIdx < named.scene.objects.size(); objIdx++) {
+                animated.objects[objIdx] = animateObject(named.scene.objects[objIdx], objIdx, frame * frameTime);
+            }
+            rt::internal::Scene scene = rt::convert(animated, clObj.context, clObj.queue);
+            raytracer.renderScene(scene, camera, config);
+            clObj.queue.finish();
+        }
+        double rebuildTime = getSecondsSince(startTime) / frames;
+
+        rt::DynamicScene dynamicScene(clObj.context, clObj.queue);
+        dynamicScene.setScene(named.scene);
+        dynamicScene.update();
+        float maxCostRatio = 1.0f;
+
+        startTime = std::chrono::high_resolution_clock::now();
+        for (int frame = 0; frame < frames; frame++) {
+            for (uint32_t objIdx = 0; objIdx < named.scene.objects.size(); objIdx++) {
+                dynamicScene.setObject(objIdx, animateObject(named.scene.objects[objIdx], objIdx, frame * frameTime));
+            }
+            dynamicScene.update();
+            raytracer.renderScene(dynamicScene.getScene(), camera, config);
+            clObj.queue.finish();
+            maxCostRatio = std::max(maxCostRatio, dynamicScene.getBvhCostRatio());
+        }
+        double refitTime = getSecondsSince(startTime) / frames;
+
+        printf(
+            "%16s | %18.3f | %18.3f | %10u | %10.2f\n",
+            named.name, rebuildTime * 1000, refitTime * 1000, dynamicScene.getBvhRebuildCount(), maxCostRatio
+        );
+    }
+}
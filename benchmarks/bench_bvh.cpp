@@ -0,0 +1,45 @@
+
+#include "benchmarks/common.h"
+
+
+int main() {
+    // kept small so that the linear scan finishes in reasonable time
+    const int imageWidth = 320;
+    const int imageHeight = 180;
+    const int warmupIterations = 1;
+    const int iterations = 5;
+    // single bounce so that every sample traces exactly one ray
+    const rt::Config config = {.sampleCount = 4, .bounceLimit = 1};
+    const int triangleCounts[] = {1'000, 10'000, 100'000};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, false);
+    raytracer.createClKernels(config);
+
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    double raysPerRender = (double) imageWidth * imageHeight * config.sampleCount;
+
+    printf("\n%10s | %16s | %16s | %8s\n", "triangles", "linear (Mrays/s)", "bvh (Mrays/s)", "speedup");
+    for (int triangleCount : triangleCounts) {
+        rt::Scene scene = createScene_triangleSoup(triangleCount);
+        rt::internal::Scene linearScene = rt::convert(scene, clObj.context, clObj.queue, false);
+        rt::internal::Scene bvhScene = rt::convert(scene, clObj.context, clObj.queue, true);
+
+        double linearTime = timeRenderScene(raytracer, linearScene, camera, config, warmupIterations, iterations);
+        double bvhTime = timeRenderScene(raytracer, bvhScene, camera, config, warmupIterations, iterations);
+
+        printf(
+            "%10d | %16.3f | %16.3f | %7.2fx\n",
+            triangleCount,
+            raysPerRender / linearTime / 1'000'000,
+            raysPerRender / bvhTime / 1'000'000,
+            linearTime / bvhTime
+        );
+    }
+}
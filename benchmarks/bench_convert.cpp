@@ -0,0 +1,73 @@
+
+#include "benchmarks/common.h"
+
+
+// `count` spheres, every one with its own material pointer if `materialPerObject`, drawn from `numMaterialValues` values
+static rt::Scene createScene_manySpheres(int count, int numMaterialValues, bool materialPerObject) {
+    std::vector<std::shared_ptr<rt::internal::Material>> palette;
+    for (int i = 0; i < numMaterialValues; i++) {
+        palette.push_back(rt::createMaterial({(float) i / numMaterialValues, 0.5f, 0.5f}, 0.0f));
+    }
+
+    rt::Scene scene;
+    scene.backgroundColor = {0.6f, 0.7f, 0.9f};
+    scene.objects.reserve(count);
+    for (int i = 0; i < count; i++) {
+        glm::vec3 position = {(float) (i % 1000), (float) (i / 1000), 0.0f};
+        int materialIdx = (i * 7) % numMaterialValues;
+        auto material = materialPerObject ? std::make_shared<rt::internal::Material>(*palette[materialIdx]) : palette[materialIdx];
+        scene.objects.push_back(rt::createSphere(position, 0.4f, material));
+    }
+    return scene;
+}
+
+
+// the grouping `convert` used to do, by pointer with a linear search
+static size_t groupMaterialsLinear(const rt::Scene& scene, int numObjects) {
+    std::vector<std::shared_ptr<rt::internal::Material>> uniqueMaterials;
+    std::vector<uint32_t> materialIndices(numObjects);
+    for (int objIdx = 0; objIdx < numObjects; objIdx++) {
+        auto matLocation = std::find(uniqueMaterials.begin(), uniqueMaterials.end(), scene.objects[objIdx].material);
+        if (matLocation == uniqueMaterials.end()) {
+            uniqueMaterials.push_back(scene.objects[objIdx].material);
+            materialIndices[objIdx] = uniqueMaterials.size() - 1;
+        } else {
+            materialIndices[objIdx] = matLocation - uniqueMaterials.begin();
+        }
+    }
+    return uniqueMaterials.size();
+}
+
+
+int main() {
+    const int numObjects = 1'000'000;
+    const int numMaterialValues = 64;
+    // the linear search is quadratic when every object has its own material, so it only gets a slice of the scene
+    const int numLinearObjects = 20'000;
+    const int iterations = 5;
+
+    NamedScene scenes[] = {
+        {"shared materials", createScene_manySpheres(numObjects, numMaterialValues, false)},
+        {"material per object", createScene_manySpheres(numObjects, numMaterialValues, true)},
+    };
+
+    printf("\n%20s | %12s | %12s | %10s | %24s\n", "scene", "objects", "convert (ms)", "materials", "linear grouping 20k (ms)");
+    for (const NamedScene& named : scenes) {
+        // host side only, without the bvh
+        rt::SceneData data;
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < iterations; i++) {
+            data = rt::buildSceneData(named.scene, false);
+        }
+        double convertTime = getSecondsSince(startTime) / iterations;
+
+        startTime = std::chrono::high_resolution_clock::now();
+        size_t linearMaterials = groupMaterialsLinear(named.scene, numLinearObjects);
+        double linearTime = getSecondsSince(startTime);
+
+        printf(
+            "%20s | %12d | %12.3f | %10d | %16.3f (%zu materials)\n",
+            named.name, (int) named.scene.objects.size(), convertTime * 1000, (int) data.materials.size(), linearTime * 1000, linearMaterials
+        );
+    }
+}
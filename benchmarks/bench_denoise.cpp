@@ -0,0 +1,82 @@
+
+#include "benchmarks/common.h"
+#include <cmath>
+
+
+// of the [0, 1] clamped rgb channels
+static double computePsnr(const std::vector<float>& image, const std::vector<float>& reference) {
+    double squaredError = 0.0;
+    size_t numValues = 0;
+    for (size_t i = 0; i < image.size(); i++) {
+        if (i % 4 == 3) {
+            continue;
+        }
+        double delta = std::clamp(image[i], 0.0f, 1.0f) - std::clamp(reference[i], 0.0f, 1.0f);
+        squaredError += delta * delta;
+        numValues++;
+    }
+    double mse = squaredError / numValues;
+    return mse > 0.0 ? 10.0 * std::log10(1.0 / mse) : INFINITY;
+}
+
+
+int main() {
+    const int imageWidth = 1280;
+    const int imageHeight = 720;
+    const uint32_t samplesPerFrame = 16;
+    const uint32_t referenceSampleCount = 8192;
+    const uint32_t sampleCounts[] = {16, 32, 64, 256, 1024};
+    const rt::Config config = {.sampleCount = samplesPerFrame, .bounceLimit = 5};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, true);
+    raytracer.createClKernels(config);
+    raytracer.setAovOutput(true);
+
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    auto scenes = createAllScenes(clObj.context, clObj.queue);
+    const auto& scene = scenes[7];
+
+    // accumulates `sampleCount` samples per pixel into a fresh image
+    auto render = [&](uint32_t sampleCount) {
+        raytracer.resetFrameCount();
+        for (uint32_t i = 0; i < sampleCount / samplesPerFrame; i++) {
+            raytracer.renderScene(scene, camera, config);
+            raytracer.accumulatePixels();
+        }
+    };
+
+    std::vector<float> reference(imageWidth * imageHeight * 4);
+    std::vector<float> pixels(reference.size());
+    render(referenceSampleCount);
+    raytracer.readPixels(reference.data());
+
+    // warmup, builds the denoiser
+    raytracer.denoise();
+
+    printf("\n%8s | %12s | %10s | %12s | %10s | %14s\n", "spp", "render (ms)", "psnr (dB)", "denoise (ms)", "total (ms)", "denoised (dB)");
+    for (uint32_t sampleCount : sampleCounts) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        render(sampleCount);
+        double renderTime = getSecondsSince(startTime);
+        raytracer.readPixels(pixels.data());
+        double psnr = computePsnr(pixels, reference);
+
+        startTime = std::chrono::high_resolution_clock::now();
+        raytracer.denoise();
+        double denoiseTime = getSecondsSince(startTime);
+        raytracer.readPixels(pixels.data());
+        double denoisedPsnr = computePsnr(pixels, reference);
+
+        printf(
+            "%8u | %12.3f | %10.2f | %12.3f | %10.3f | %14.2f\n",
+            sampleCount, renderTime * 1000, psnr, denoiseTime * 1000, (renderTime + denoiseTime) * 1000, denoisedPsnr
+        );
+    }
+}
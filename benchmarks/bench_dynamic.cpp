@@ -0,0 +1,60 @@
+
+#include "benchmarks/common.h"
+#include "src/dynamic_scene.h"
+
+
+int main() {
+    const int imageWidth = 640;
+    const int imageHeight = 360;
+    const int gridSize = 317;
+    const int moves = 1000;
+    const rt::Config config = {.sampleCount = 4, .bounceLimit = 2};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA8, false);
+    raytracer.createClKernels(config);
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+
+    rt::Scene scene = createScene_sphereGrid(gridSize);
+    printf("Scene: %d spheres\n", (int) scene.objects.size());
+
+    // baseline, what every edit used to cost
+    auto startTime = std::chrono::high_resolution_clock::now();
+    rt::internal::Scene convertedScene = rt::convert(scene, clObj.context, clObj.queue);
+    clObj.queue.finish();
+    double convertTime = getSecondsSince(startTime);
+
+    rt::DynamicScene dynamicScene(clObj.context, clObj.queue);
+    dynamicScene.setScene(scene);
+    dynamicScene.update();
+    clObj.queue.finish();
+    size_t fullUploadSize = dynamicScene.getLastUploadSize();
+
+    // moving one sphere at a time, up and down
+    size_t totalUploadSize = 0;
+    startTime = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < moves; i++) {
+        uint32_t objIdx = (i * 7919) % scene.objects.size();
+        const auto& sphere = std::get<rt::internal::Sphere>(scene.objects[objIdx].internal);
+        glm::vec3 position = rt::toVec3(sphere.position) + glm::vec3(0.0f, 0.0f, (i % 2) ? 0.5f : -0.5f);
+
+        dynamicScene.setObject(objIdx, rt::createSphere(position, sphere.radius, scene.objects[objIdx].material));
+        dynamicScene.update();
+        clObj.queue.finish();
+        totalUploadSize += dynamicScene.getLastUploadSize();
+    }
+    double moveTime = getSecondsSince(startTime) / moves;
+
+    // the edits have to be visible to the kernel
+    raytracer.renderScene(dynamicScene.getScene(), camera, config);
+    raytracer.saveAsImage("bench_dynamic.png");
+
+    printf("Full convert:  %10.3f ms (%.1f KB)\n", convertTime * 1000, (double) fullUploadSize / 1024);
+    printf("Move 1 sphere: %10.3f us (%.1f bytes uploaded on average)\n", moveTime * 1'000'000, (double) totalUploadSize / moves);
+}
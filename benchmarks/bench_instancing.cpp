@@ -0,0 +1,85 @@
+
+#include "benchmarks/common.h"
+
+
+// `count` copies of a uv sphere mesh in a square grid, as instances or with every copy's vertices baked into its own mesh
+static rt::Scene createScene_meshCopies(int count, bool instanced) {
+    auto material = rt::createMaterial({0.3f, 0.6f, 0.3f}, 0.0f);
+    rt::Mesh mesh = createUvSphereMesh({0.0f, 0.0f, 0.0f}, 0.4f, 16, 32, true, material);
+
+    rt::Scene scene;
+    scene.backgroundColor = {0.5f, 0.7f, 1.0f};
+    scene.objects.push_back(rt::createSphere({0.0f, -1000.5f, 0.0f}, 1000.0f, material));
+    if (instanced) {
+        scene.meshes.push_back(mesh);
+    }
+
+    int gridSize = (int) std::ceil(std::sqrt((float) count));
+    for (int i = 0; i < count; i++) {
+        glm::vec3 position = {(i % gridSize - gridSize / 2) * 1.0f, 0.0f, -(i / gridSize) * 1.0f};
+        glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+        transform = glm::rotate(transform, i * 0.7f, glm::vec3(0.0f, 1.0f, 0.0f));
+        if (instanced) {
+            scene.instances.push_back(rt::createMeshInstance(0, transform));
+            continue;
+        }
+
+        rt::Mesh copy = mesh;
+        for (glm::vec3& v : copy.vertices) {
+            v = glm::vec3(transform * glm::vec4(v, 1.0f));
+        }
+        for (glm::vec3& n : copy.normals) {
+            n = glm::normalize(glm::vec3(transform * glm::vec4(n, 0.0f)));
+        }
+        scene.meshes.push_back(std::move(copy));
+    }
+    return scene;
+}
+
+
+static size_t getDeviceSize(const rt::SceneData& data) {
+    return data.spheres.size() * sizeof(rt::internal::Sphere)
+        + (data.vertices.size() + data.normals.size()) * sizeof(cl_float3)
+        + data.triangles.size() * sizeof(rt::internal::TriangleIndices)
+        + data.materials.size() * sizeof(rt::internal::Material)
+        + data.bvhNodes.size() * sizeof(rt::internal::BvhNode)
+        + data.instances.size() * sizeof(rt::internal::Instance);
+}
+
+
+int main() {
+    const int imageWidth = 640;
+    const int imageHeight = 360;
+    const int iterations = 10;
+    const rt::Config config = {.sampleCount = 4, .bounceLimit = 2};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA8, false);
+    raytracer.createClKernels(config);
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 3, 4}, {0, -0.4f, -1});
+
+    printf("\n%8s | %12s | %12s | %12s | %12s\n", "copies", "layout", "build (ms)", "memory (MB)", "render (ms)");
+    for (int count : {100, 1'000, 10'000}) {
+        for (bool instanced : {true, false}) {
+            rt::Scene scene = createScene_meshCopies(count, instanced);
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+            rt::SceneData data = rt::buildSceneData(scene);
+            double buildTime = getSecondsSince(startTime);
+
+            rt::internal::Scene convertedScene = rt::upload(data, clObj.context, clObj.queue);
+            double renderTime = timeRenderScene(raytracer, convertedScene, camera, config, 2, iterations);
+
+            printf(
+                "%8d | %12s | %12.3f | %12.3f | %12.3f\n",
+                count, instanced ? "instanced" : "flattened", buildTime * 1000, (double) getDeviceSize(data) / (1024 * 1024), renderTime * 1000
+            );
+        }
+    }
+}
@@ -0,0 +1,67 @@
+
+#include "benchmarks/common.h"
+
+
+// size of the previous union layout (rt_Object): a 48 byte sphere/triangle union + type + material index, padded to 16 bytes
+static const size_t UNION_OBJECT_SIZE = 64;
+
+
+static size_t getBufferSize(const cl::Buffer& buffer) {
+    return buffer() == nullptr ? 0 : buffer.getInfo<CL_MEM_SIZE>();
+}
+
+
+int main() {
+    const int imageWidth = 640;
+    const int imageHeight = 360;
+    const int warmupIterations = 1;
+    const int iterations = 5;
+    // single bounce so that every sample traces exactly one ray
+    const rt::Config config = {.sampleCount = 4, .bounceLimit = 1};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, false);
+    raytracer.createClKernels(config);
+
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    double raysPerRender = (double) imageWidth * imageHeight * config.sampleCount;
+
+    NamedScene scenes[] = {
+        {"scene 7", createScene_7()},
+        {"spheres 10k", createScene_sphereGrid(100)},
+        {"triangles 10k", createScene_triangleSoup(10'000)},
+        {"triangles 100k", createScene_triangleSoup(100'000)},
+        {"mesh 100k", {}},
+    };
+    // the same triangle count as the soup, as an indexed mesh with normals
+    scenes[4].scene.meshes.push_back(createUvSphereMesh({0.0f, 0.0f, 0.0f}, 2.0f, 224, 224, true, rt::createMaterial({0.8f, 0.8f, 0.8f}, 0.0f)));
+    scenes[4].scene.backgroundColor = {0.6f, 0.7f, 0.9f};
+
+    printf("\n%16s | %12s | %12s | %12s | %12s\n", "scene", "union (KB)", "per-type (KB)", "saved", "bvh (Mrays/s)");
+    for (const NamedScene& named : scenes) {
+        rt::internal::Scene scene = rt::convert(named.scene, clObj.context, clObj.queue, true);
+
+        size_t primitiveCount = named.scene.objects.size();
+        for (const rt::Mesh& mesh : named.scene.meshes) {
+            primitiveCount += mesh.indices.size() / 3;
+        }
+        size_t unionSize = primitiveCount * UNION_OBJECT_SIZE;
+        size_t perTypeSize = getBufferSize(scene.spheresBuffer) + getBufferSize(scene.verticesBuffer) + getBufferSize(scene.normalsBuffer) + getBufferSize(scene.trianglesBuffer);
+        double time = timeRenderScene(raytracer, scene, camera, config, warmupIterations, iterations);
+
+        printf(
+            "%16s | %12.1f | %12.1f | %11.1f%% | %12.3f\n",
+            named.name,
+            (double) unionSize / 1024,
+            (double) perTypeSize / 1024,
+            100.0 * (1.0 - (double) perTypeSize / unionSize),
+            raysPerRender / time / 1'000'000
+        );
+    }
+}
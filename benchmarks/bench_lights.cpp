@@ -0,0 +1,68 @@
+
+#include "benchmarks/common.h"
+
+
+int main() {
+    const int imageWidth = 1280;
+    const int imageHeight = 720;
+    const uint32_t samplesPerFrame = 4;
+    const uint32_t referenceSampleCount = 4096;
+    const uint32_t sampleCounts[] = {4, 16, 64, 256};
+    const rt::Config config = {.sampleCount = samplesPerFrame, .bounceLimit = 5};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, true);
+    raytracer.createClKernels(config);
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+
+    // accumulates `sampleCount` samples per pixel into a fresh image, returns the seconds taken
+    auto render = [&](const rt::internal::Scene& scene, uint32_t sampleCount) {
+        raytracer.resetFrameCount();
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for (uint32_t i = 0; i < sampleCount / samplesPerFrame; i++) {
+            raytracer.renderScene(scene, camera, config);
+            raytracer.accumulatePixels();
+        }
+        clObj.queue.finish();
+        return getSecondsSince(startTime);
+    };
+
+    // a small sphere light, and a large one
+    NamedScene scenes[] = {
+        {"scene 5", createScene_5()},
+        {"scene 9", createScene_9()},
+    };
+
+    std::vector<float> reference(imageWidth * imageHeight * 4);
+    std::vector<float> pixels(reference.size());
+    printf("\n%8s | %10s | %8s | %12s | %14s\n", "scene", "lights", "spp", "rmse", "ms per frame");
+    for (const NamedScene& named : scenes) {
+        rt::SceneData data = rt::buildSceneData(named.scene);
+        rt::internal::Scene lightSampled = rt::upload(data, clObj.context, clObj.queue);
+        // without emitters, the kernel only finds the lights through bsdf samples
+        data.emitters.clear();
+        data.emitterPower = 0.0f;
+        rt::internal::Scene bsdfOnly = rt::upload(data, clObj.context, clObj.queue);
+
+        render(lightSampled, referenceSampleCount);
+        raytracer.readPixels(reference.data());
+
+        for (bool sampleLights : {false, true}) {
+            for (uint32_t sampleCount : sampleCounts) {
+                double time = render(sampleLights ? lightSampled : bsdfOnly, sampleCount);
+                raytracer.readPixels(pixels.data());
+                printf(
+                    "%8s | %10s | %8u | %12.6f | %14.3f\n",
+                    named.name, sampleLights ? "sampled" : "bsdf only", sampleCount, computeRmse(pixels, reference),
+                    time / (sampleCount / samplesPerFrame) * 1000
+                );
+            }
+        }
+    }
+}
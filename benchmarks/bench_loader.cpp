@@ -0,0 +1,95 @@
+
+#include "benchmarks/common.h"
+#include "src/mesh_loader.h"
+#include <filesystem>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+
+static double getPeakMemoryMB() {
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters;
+    GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+    return (double) counters.PeakWorkingSetSize / (1024 * 1024);
+#else
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    // in KB on linux
+    return (double) usage.ru_maxrss / 1024;
+#endif
+}
+
+
+// smooth uv sphere with `v`/`vn` lines and `f v//vn` faces, roughly 2 * `rings` * `segments` triangles
+static bool writeObj(const char* filepath, int rings, int segments) {
+    rt::Mesh mesh = createUvSphereMesh({0.0f, 0.0f, 0.0f}, 2.0f, rings, segments, true, nullptr);
+
+    FILE* file = fopen(filepath, "w");
+    if (!file) {
+        return false;
+    }
+    for (const glm::vec3& v : mesh.vertices) {
+        fprintf(file, "v %f %f %f\n", v.x, v.y, v.z);
+    }
+    for (const glm::vec3& n : mesh.normals) {
+        fprintf(file, "vn %f %f %f\n", n.x, n.y, n.z);
+    }
+    for (size_t i = 0; i < mesh.indices.size(); i += 3) {
+        uint32_t a = mesh.indices[i] + 1, b = mesh.indices[i + 1] + 1, c = mesh.indices[i + 2] + 1;
+        fprintf(file, "f %u//%u %u//%u %u//%u\n", a, a, b, b, c, c);
+    }
+    fclose(file);
+    return true;
+}
+
+
+int main(int argc, char* argv[]) {
+    // a generated file is reused between runs, so that its creation does not count towards the peak memory
+    std::string filepath = argc > 1 ? argv[1] : "benchmarks/loader_sphere.obj";
+    if (argc <= 1 && !std::filesystem::exists(filepath)) {
+        printf("Generating %s ...\n", filepath.c_str());
+        if (!writeObj(filepath.c_str(), 1024, 1024)) {
+            printf("ERROR (`main`): Unable to write %s\n", filepath.c_str());
+            return 1;
+        }
+        printf("Run again to measure the peak memory without the generation\n");
+    }
+
+    double baseMemory = getPeakMemoryMB();
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    rt::Mesh mesh;
+    if (!rt::loadMesh(filepath.c_str(), rt::createMaterial({0.8f, 0.8f, 0.8f}, 0.0f), mesh)) {
+        return 1;
+    }
+    double loadTime = getSecondsSince(startTime);
+    double loadMemory = getPeakMemoryMB();
+
+    double fileSize = (double) std::filesystem::file_size(filepath) / (1024 * 1024);
+    printf("File: %s (%.1f MB)\n", filepath.c_str(), fileSize);
+    printf("Mesh: %zu triangles, %zu vertices, %s normals\n", mesh.indices.size() / 3, mesh.vertices.size(), mesh.normals.empty() ? "no" : "with");
+    printf("Load: %.3f s (%.1f MB/s), peak RSS %.1f MB (+%.1f MB)\n", loadTime, fileSize / loadTime, loadMemory, loadMemory - baseMemory);
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Scene scene;
+    scene.backgroundColor = {0.6f, 0.7f, 0.9f};
+    scene.meshes.push_back(std::move(mesh));
+
+    startTime = std::chrono::high_resolution_clock::now();
+    rt::internal::Scene internalScene = rt::convert(scene, clObj.context, clObj.queue, true);
+    double convertTime = getSecondsSince(startTime);
+    double convertMemory = getPeakMemoryMB();
+    printf("Convert: %.3f s, peak RSS %.1f MB (+%.1f MB)\n", convertTime, convertMemory, convertMemory - loadMemory);
+}
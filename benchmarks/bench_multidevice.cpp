@@ -0,0 +1,53 @@
+
+#include "benchmarks/common.h"
+#include "src/multi_raytracer.h"
+
+
+int main() {
+    const int imageWidth = 1280;
+    const int imageHeight = 720;
+    const int frames = 10;
+    const rt::Config config = {.sampleCount = 32, .bounceLimit = 5};
+
+    std::vector<rt::CL_Objects> devices = rt::createClObjectsForAllDevices();
+    if (devices.empty()) {
+        printf("ERROR: No OpenCL devices found\n");
+        return 1;
+    }
+    for (int i = 0; i < devices.size(); i++) {
+        printf("Device %d: %s\n", i, rt::getClDeviceSummary(devices[i].platform, devices[i].device).c_str());
+    }
+
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    rt::Scene scene = createScene_7();
+
+    // every device on its own
+    printf("\n%6s | %10s\n", "device", "time (ms)");
+    for (int i = 0; i < devices.size(); i++) {
+        rt::Raytracer raytracer({imageWidth, imageHeight}, devices[i], rt::Format::RGBA8, false);
+        raytracer.createClKernels(config);
+        auto internalScene = rt::convert(scene, devices[i].context, devices[i].queue);
+        double time = timeRenderScene(raytracer, internalScene, camera, config, 1, frames);
+        printf("%6d | %10.3f\n", i, time * 1000);
+    }
+
+    // all of them together, the bands should settle after the first few frames
+    rt::MultiDeviceRaytracer multiRaytracer({imageWidth, imageHeight}, devices, rt::Format::RGBA8);
+    multiRaytracer.createClKernels(config);
+    auto multiScene = multiRaytracer.convertScene(scene);
+
+    printf("\n%5s | %10s | %s\n", "frame", "time (ms)", "rows per device (seconds)");
+    for (int frame = 0; frame < frames; frame++) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        multiRaytracer.renderScene(multiScene, camera, config);
+        double time = getSecondsSince(startTime);
+
+        printf("%5d | %10.3f |", frame, time * 1000);
+        for (int i = 0; i < multiRaytracer.getDeviceCount(); i++) {
+            printf(" %d (%.3f)", multiRaytracer.getBandRows()[i], multiRaytracer.getDeviceTimes()[i]);
+        }
+        printf("\n");
+    }
+
+    multiRaytracer.saveAsImage("multidevice.png");
+}
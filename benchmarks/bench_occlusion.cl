@@ -0,0 +1,47 @@
+
+#include "kernels/scene.h"
+#include "kernels/random.h"
+
+// Ray queries for bench_occlusion, built by the benchmark itself
+
+
+float hashFloat(uint* seed) {
+    *seed = pcgHash(*seed);
+    return (*seed >> 8) * (1.0f / 16777216.0f);
+}
+
+
+// Shadow ray like segments between two random points of the box, `blocked` gets whether something is in between
+// with the closest hit query (`anyHit` false) or the occlusion one
+kernel void traceSegments(
+    const rt_SceneParams scene,
+    global const rt_Sphere* spheres,
+    global const float3* vertices,
+    global const float3* normals,
+    global const rt_TriangleIndices* triangles,
+    global const rt_BvhNode* bvhNodes,
+    global const rt_Instance* instances,
+    float3 boxMin,
+    float3 boxMax,
+    uint anyHit,
+    global uchar* blocked
+) {
+    uint rayIdx = get_global_id(0);
+    uint seed = rayIdx;
+    float3 from = mix(boxMin, boxMax, (float3)(hashFloat(&seed), hashFloat(&seed), hashFloat(&seed)));
+    float3 to = mix(boxMin, boxMax, (float3)(hashFloat(&seed), hashFloat(&seed), hashFloat(&seed)));
+
+    rt_Ray ray;
+    ray.origin = from;
+    float distance = length(to - from);
+    ray.direction = (to - from) / distance;
+
+    const rt_SceneGeometry geometry = {spheres, vertices, normals, triangles, bvhNodes, instances, 0};
+    bool isBlocked;
+    if (anyHit) {
+        isBlocked = occluded(&ray, distance, &scene, &geometry);
+    } else {
+        isBlocked = traceRay(&ray, &scene, &geometry).hitDistance < distance;
+    }
+    blocked[rayIdx] = isBlocked;
+}
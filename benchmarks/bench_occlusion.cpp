@@ -0,0 +1,98 @@
+
+#include "benchmarks/common.h"
+#include "src/program_cache.h"
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+
+int main() {
+    const uint32_t numRays = 1 << 20;
+    const int iterations = 10;
+    // segments between random points of this box, around the objects of the test scenes
+    const cl_float3 boxMin = {-5.0f, -1.0f, -5.0f, 0.0f};
+    const cl_float3 boxMax = {5.0f, 4.0f, 5.0f, 0.0f};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    std::ifstream file("benchmarks/bench_occlusion.cl");
+    std::stringstream source;
+    source << file.rdbuf();
+    cl::Program program;
+    if (!rt::buildClProgram(clObj, source.str(), " -cl-std=CL2.0", program)) {
+        printf("ERROR: Unable to build benchmarks/bench_occlusion.cl\n%s\n", program.getBuildInfo<CL_PROGRAM_BUILD_LOG>(device).c_str());
+        return 1;
+    }
+    cl::Kernel kernel(program, "traceSegments");
+    cl::Buffer blockedBuffer(clObj.context, CL_MEM_WRITE_ONLY, numRays);
+
+    struct OcclusionScene {
+        const char* name;
+        rt::Scene scene;
+        // also traced without a bvh
+        bool linear;
+    };
+    OcclusionScene scenes[] = {
+        {"scene 8", createScene_8(), true},
+        {"scene 9", createScene_9(), true},
+        {"scene 10", createScene_10(), false},
+        {"spheres 10k", createScene_sphereGrid(100), false},
+        {"triangles 20k", createScene_triangleSoup(20'000), false},
+    };
+
+    printf("\n%14s | %8s | %12s | %12s | %10s | %10s\n", "scene", "layout", "query", "Mrays/sec", "blocked", "mismatches");
+    for (const OcclusionScene& named : scenes) {
+        for (bool buildBvh : {false, true}) {
+            if (!buildBvh && !named.linear) {
+                continue;
+            }
+            rt::internal::Scene scene = rt::convert(named.scene, clObj.context, clObj.queue, buildBvh);
+            kernel.setArg(0, sizeof(rt::internal::SceneExtra), &scene.extra);
+            kernel.setArg(1, scene.spheresBuffer);
+            kernel.setArg(2, scene.verticesBuffer);
+            kernel.setArg(3, scene.normalsBuffer);
+            kernel.setArg(4, scene.trianglesBuffer);
+            kernel.setArg(5, scene.bvhNodesBuffer);
+            kernel.setArg(6, scene.instancesBuffer);
+            kernel.setArg(7, sizeof(cl_float3), &boxMin);
+            kernel.setArg(8, sizeof(cl_float3), &boxMax);
+            kernel.setArg(10, blockedBuffer);
+
+            // both queries trace the same segments, so they must block the same ones
+            std::vector<uint8_t> closestHitBlocked(numRays);
+            std::vector<uint8_t> blocked(numRays);
+            for (uint32_t anyHit : {0, 1}) {
+                kernel.setArg(9, sizeof(uint32_t), &anyHit);
+                clObj.queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(numRays), cl::NullRange);
+                clObj.queue.finish();
+
+                auto startTime = std::chrono::high_resolution_clock::now();
+                for (int i = 0; i < iterations; i++) {
+                    clObj.queue.enqueueNDRangeKernel(kernel, cl::NullRange, cl::NDRange(numRays), cl::NullRange);
+                }
+                clObj.queue.finish();
+                double time = getSecondsSince(startTime) / iterations;
+
+                clObj.queue.enqueueReadBuffer(blockedBuffer, true, 0, numRays, blocked.data());
+                if (!anyHit) {
+                    closestHitBlocked = blocked;
+                }
+                uint32_t numBlocked = std::accumulate(blocked.begin(), blocked.end(), 0u);
+                uint32_t numMismatches = 0;
+                for (uint32_t i = 0; i < numRays; i++) {
+                    numMismatches += blocked[i] != closestHitBlocked[i];
+                }
+                printf(
+                    "%14s | %8s | %12s | %12.3f | %10.3f | %10u\n",
+                    named.name, buildBvh ? "bvh" : "linear", anyHit ? "occluded" : "closest hit",
+                    numRays / time / 1e6, (double) numBlocked / numRays, numMismatches
+                );
+            }
+        }
+    }
+}
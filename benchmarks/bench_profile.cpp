@@ -0,0 +1,61 @@
+
+#include "benchmarks/common.h"
+
+
+// per-command device time of both pipelines, the commands are also written to a chrome trace
+int main() {
+    const int imageWidth = 1280;
+    const int imageHeight = 720;
+    const int frames = 5;
+    const rt::Config config = {.sampleCount = 8, .bounceLimit = 5};
+    const char* traceFilepath = "profile_trace.json";
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device, true);
+
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    auto scenes = createAllScenes(clObj.context, clObj.queue);
+    const auto& scene = scenes[7];
+
+    rt::Profiler profiler;
+    rt::Pipeline pipelines[] = {rt::Pipeline::Megakernel, rt::Pipeline::Wavefront};
+    for (rt::Pipeline pipeline : pipelines) {
+        rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, true, 0, pipeline);
+        raytracer.createClKernels(config);
+
+        double unprofiledTime = timeRenderScene(raytracer, scene, camera, config, 1, frames);
+
+        raytracer.setProfiler(&profiler);
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < frames; i++) {
+            raytracer.renderScene(scene, camera, config);
+            raytracer.accumulatePixels();
+        }
+        double profiledTime = getSecondsSince(startTime) / frames;
+
+        rt::FrameStats stats;
+        if (!raytracer.getLastFrameStats(stats)) {
+            printf("ERROR: No profiled frame completed\n");
+            return 1;
+        }
+
+        printf("\n%s: %.3f ms per frame (%.3f ms without profiling)\n", pipeline == rt::Pipeline::Megakernel ? "megakernel" : "wavefront", profiledTime * 1000, unprofiledTime * 1000);
+        printf("frame %u, %u commands, %.3f ms on the device\n", stats.frame, stats.numCommands, stats.totalMs);
+        for (const auto& [name, ms] : stats.commandMs) {
+            printf("  %16s | %10.3f ms\n", name.c_str(), ms);
+        }
+        raytracer.setProfiler(nullptr);
+    }
+
+    profiler.collect(true);
+    if (profiler.getNumFailedCommands() > 0) {
+        printf("\nWARN: %u commands failed and were left out of the timings\n", profiler.getNumFailedCommands());
+    }
+    if (profiler.exportChromeTrace(traceFilepath)) {
+        printf("\nTrace written to %s\n", traceFilepath);
+    }
+}
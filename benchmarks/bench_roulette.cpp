@@ -0,0 +1,55 @@
+
+#include "benchmarks/common.h"
+
+
+int main() {
+    const int imageWidth = 1280;
+    const int imageHeight = 720;
+    const int iterations = 10;
+    const uint32_t sampleCount = 4;
+    const uint32_t bounceLimits[] = {5, 16};
+    const uint32_t rouletteDepth = 3;
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA8, false);
+    raytracer.setRayCounting(true);
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+
+    NamedScene scenes[] = {
+        {"scene 5", createScene_5()},
+        {"scene 8", createScene_8()},
+        {"scene 9", createScene_9()},
+    };
+
+    printf("\n%8s | %8s | %10s | %12s | %14s | %12s\n", "scene", "bounces", "roulette", "ms/frame", "Mpaths/sec", "path length");
+    for (const NamedScene& named : scenes) {
+        // without emitters no shadow rays are traced, so the ray count is the number of path segments
+        rt::SceneData data = rt::buildSceneData(named.scene);
+        data.emitters.clear();
+        data.emitterPower = 0.0f;
+        rt::internal::Scene scene = rt::upload(data, clObj.context, clObj.queue);
+
+        for (uint32_t bounceLimit : bounceLimits) {
+            for (bool roulette : {false, true}) {
+                const rt::Config config = {.sampleCount = sampleCount, .bounceLimit = bounceLimit, .rouletteDepth = roulette ? rouletteDepth : bounceLimit};
+                raytracer.createClKernels(config);
+                raytracer.renderScene(scene, camera, config);
+
+                raytracer.resetRayCount();
+                double frameTime = timeRenderScene(raytracer, scene, camera, config, 0, iterations);
+                double numPaths = (double) imageWidth * imageHeight * sampleCount * iterations;
+                printf(
+                    "%8s | %8u | %10s | %12.3f | %14.3f | %12.3f\n",
+                    named.name, bounceLimit, roulette ? "on" : "off", frameTime * 1000,
+                    numPaths / (frameTime * iterations) / 1e6, raytracer.getRayCount() / numPaths
+                );
+            }
+        }
+    }
+}
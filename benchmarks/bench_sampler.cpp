@@ -0,0 +1,71 @@
+
+#include "benchmarks/common.h"
+
+
+int main() {
+    const int imageWidth = 1280;
+    const int imageHeight = 720;
+    const uint32_t maxSampleCount = 256;
+    const uint32_t referenceSampleCount = 8192;
+    // one sample per frame, so that the error can be read after every power of two
+    const rt::Config config = {.sampleCount = 1, .bounceLimit = 5};
+    const rt::Config referenceConfig = {.sampleCount = 16, .bounceLimit = 5};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, true);
+    raytracer.createClKernels(config);
+    raytracer.createClKernels(referenceConfig);
+
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    auto scenes = createAllScenes(clObj.context, clObj.queue);
+    const auto& scene = scenes[7];
+
+    std::vector<float> reference(imageWidth * imageHeight * 4);
+    std::vector<float> pixels(reference.size());
+    raytracer.resetFrameCount();
+    for (uint32_t i = 0; i < referenceSampleCount / referenceConfig.sampleCount; i++) {
+        raytracer.renderScene(scene, camera, referenceConfig);
+        raytracer.accumulatePixels();
+    }
+    raytracer.readPixels(reference.data());
+
+    struct NamedSampler {
+        const char* name;
+        rt::Sampler sampler;
+    };
+    NamedSampler samplers[] = {
+        {"random", rt::Sampler::Random},
+        {"sobol", rt::Sampler::Sobol},
+    };
+
+    printf("\n%8s | %8s | %12s | %14s\n", "sampler", "spp", "rmse", "ms per frame");
+    for (const NamedSampler& named : samplers) {
+        raytracer.setSampler(named.sampler);
+        // warmup
+        raytracer.renderScene(scene, camera, config);
+
+        raytracer.resetFrameCount();
+        double frameTime = 0.0;
+        for (uint32_t sampleCount = 1; sampleCount <= maxSampleCount; sampleCount++) {
+            auto startTime = std::chrono::high_resolution_clock::now();
+            raytracer.renderScene(scene, camera, config);
+            raytracer.accumulatePixels();
+            clObj.queue.finish();
+            frameTime += getSecondsSince(startTime);
+
+            if ((sampleCount & (sampleCount - 1)) == 0) {
+                raytracer.readPixels(pixels.data());
+                printf(
+                    "%8s | %8u | %12.6f | %14.3f\n",
+                    named.name, sampleCount, computeRmse(pixels, reference), frameTime / sampleCount * 1000
+                );
+            }
+        }
+    }
+}
@@ -0,0 +1,46 @@
+
+#include "benchmarks/common.h"
+#include "src/program_cache.h"
+#include <filesystem>
+
+
+// time for a fresh raytracer to get its kernels ready
+static double timeCreateClKernels(const rt::CL_Objects& clObj, const rt::Config& config, bool& fromCache) {
+    rt::Raytracer raytracer({64, 64}, clObj, rt::Format::RGBA32F, false);
+    auto startTime = std::chrono::high_resolution_clock::now();
+    raytracer.createClKernels(config);
+    double timeTaken = getSecondsSince(startTime);
+    fromCache = raytracer.areKernelsFromCache();
+    return timeTaken;
+}
+
+
+int main() {
+    const int warmRuns = 5;
+    const rt::Config config = {.sampleCount = 16, .bounceLimit = 5};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    // separate directory so that the regular cache is left untouched
+    std::string cacheDir = rt::getClCacheDir() + "-bench";
+    std::filesystem::remove_all(cacheDir);
+    rt::setClCacheDir(cacheDir);
+
+    bool fromCache;
+    double coldTime = timeCreateClKernels(clObj, config, fromCache);
+    printf("\nCold start: %8.3f ms (from cache: %s)\n", coldTime * 1000, fromCache ? "true" : "false");
+
+    double warmTime = 0.0;
+    for (int i = 0; i < warmRuns; i++) {
+        warmTime += timeCreateClKernels(clObj, config, fromCache) / warmRuns;
+    }
+    printf("Warm start: %8.3f ms (from cache: %s, avg of %d)\n", warmTime * 1000, fromCache ? "true" : "false", warmRuns);
+    printf("Speedup:    %8.2fx\n", coldTime / warmTime);
+
+    std::filesystem::remove_all(cacheDir);
+}
@@ -0,0 +1,254 @@
+
+#include "benchmarks/common.h"
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+// Headless regression benchmark over every built-in test scene, printed with its usage on invalid options
+static const char USAGE[] =
+    "usage: bench_suite.exe [options]\n"
+    "  --device gpu|cpu|all         device type to run on (default: all, gpus are preferred)\n"
+    "                               RT_CL_DEVICE can narrow it down further\n"
+    "  --resolutions 320x180,...    image sizes (default: 320x180,640x360,1280x720)\n"
+    "  --configs 4x5,16x5           sampleCount x bounceLimit pairs (default: 4x5,16x5)\n"
+    "  --pipeline mega|wave|both    (default: mega)\n"
+    "  --warmup N                   untimed renders per case (default: 2)\n"
+    "  --iterations N               timed renders per case (default: 10)\n"
+    "  --format json|csv            (default: json)\n"
+    "  --out FILE                   (default: stdout)\n";
+
+
+struct SuiteOptions {
+    cl_device_type deviceType = CL_DEVICE_TYPE_ALL;
+    std::vector<glm::ivec2> resolutions = {{320, 180}, {640, 360}, {1280, 720}};
+    std::vector<rt::Config> configs = {{.sampleCount = 4, .bounceLimit = 5}, {.sampleCount = 16, .bounceLimit = 5}};
+    std::vector<rt::Pipeline> pipelines = {rt::Pipeline::Megakernel};
+    int warmupIterations = 2;
+    int iterations = 10;
+    bool csv = false;
+    std::string outFilepath;
+};
+
+
+struct CaseResult {
+    int sceneIdx;
+    glm::ivec2 resolution;
+    rt::Config config;
+    rt::Pipeline pipeline;
+    double meanTime;
+    double stddevTime;
+    double minTime;
+    double samplesPerSec;
+    double raysPerSec;
+};
+
+
+static std::vector<std::string> splitString(const std::string& str, char delimiter) {
+    std::vector<std::string> out;
+    std::stringstream stream(str);
+    std::string item;
+    while (std::getline(stream, item, delimiter)) {
+        out.push_back(item);
+    }
+    return out;
+}
+
+
+static bool parseOptions(int argc, char* argv[], SuiteOptions& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 >= argc) {
+            printf("ERROR: Missing value for %s\n", arg.c_str());
+            return false;
+        }
+        std::string value = argv[++i];
+
+        if (arg == "--device") {
+            if (value == "gpu") {
+                options.deviceType = CL_DEVICE_TYPE_GPU;
+            } else if (value == "cpu") {
+                options.deviceType = CL_DEVICE_TYPE_CPU;
+            } else if (value == "all") {
+                options.deviceType = CL_DEVICE_TYPE_ALL;
+            } else {
+                printf("ERROR: Unknown device type %s\n", value.c_str());
+                return false;
+            }
+        } else if (arg == "--resolutions") {
+            options.resolutions.clear();
+            for (const std::string& item : splitString(value, ',')) {
+                glm::ivec2 resolution;
+                if (sscanf(item.c_str(), "%dx%d", &resolution.x, &resolution.y) == 2) {
+                    options.resolutions.push_back(resolution);
+                }
+            }
+        } else if (arg == "--configs") {
+            options.configs.clear();
+            for (const std::string& item : splitString(value, ',')) {
+                rt::Config config;
+                if (sscanf(item.c_str(), "%ux%u", &config.sampleCount, &config.bounceLimit) == 2) {
+                    options.configs.push_back(config);
+                }
+            }
+        } else if (arg == "--pipeline") {
+            options.pipelines.clear();
+            if (value == "mega" || value == "both") {
+                options.pipelines.push_back(rt::Pipeline::Megakernel);
+            }
+            if (value == "wave" || value == "both") {
+                options.pipelines.push_back(rt::Pipeline::Wavefront);
+            }
+        } else if (arg == "--warmup") {
+            options.warmupIterations = std::max(0, atoi(value.c_str()));
+        } else if (arg == "--iterations") {
+            options.iterations = std::max(1, atoi(value.c_str()));
+        } else if (arg == "--format") {
+            options.csv = value == "csv";
+        } else if (arg == "--out") {
+            options.outFilepath = value;
+        } else {
+            printf("ERROR: Unknown option %s\n", arg.c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+
+static CaseResult runCase(rt::Raytracer& raytracer, const rt::internal::Scene& scene, const rt::Config& config, const SuiteOptions& options) {
+    glm::ivec2 resolution = raytracer.getImageShape();
+    auto camera = rt::createCamera(60.0f, resolution, {0, 0, 6}, {0, 0, -1});
+
+    for (int i = 0; i < options.warmupIterations; i++) {
+        raytracer.renderScene(scene, camera, config);
+    }
+
+    std::vector<double> times(options.iterations);
+    for (int i = 0; i < options.iterations; i++) {
+        auto startTime = std::chrono::high_resolution_clock::now();
+        raytracer.renderScene(scene, camera, config);
+        times[i] = getSecondsSince(startTime);
+    }
+
+    // counting in a separate render so that the atomics don't affect the timings
+    raytracer.setRayCounting(true);
+    raytracer.resetRayCount();
+    raytracer.renderScene(scene, camera, config);
+    double raysPerRender = (double) raytracer.getRayCount();
+    raytracer.setRayCounting(false);
+
+    CaseResult result = {};
+    result.resolution = resolution;
+    result.config = config;
+    result.pipeline = raytracer.getPipeline();
+    result.minTime = times[0];
+    for (double time : times) {
+        result.meanTime += time / times.size();
+        result.minTime = std::min(result.minTime, time);
+    }
+    for (double time : times) {
+        result.stddevTime += (time - result.meanTime) * (time - result.meanTime) / times.size();
+    }
+    result.stddevTime = std::sqrt(result.stddevTime);
+    result.samplesPerSec = (double) resolution.x * resolution.y * config.sampleCount / result.meanTime;
+    result.raysPerSec = raysPerRender / result.meanTime;
+    return result;
+}
+
+
+static void writeResults(std::ostream& out, const std::vector<CaseResult>& results, const SuiteOptions& options, const std::string& deviceName) {
+    char line[512];
+
+    if (options.csv) {
+        out << "scene,width,height,samples,bounces,pipeline,mean_ms,stddev_ms,min_ms,samples_per_sec,rays_per_sec\n";
+        for (const CaseResult& r : results) {
+            snprintf(
+                line, sizeof(line), "%d,%d,%d,%u,%u,%s,%.4f,%.4f,%.4f,%.1f,%.1f\n",
+                r.sceneIdx, r.resolution.x, r.resolution.y, r.config.sampleCount, r.config.bounceLimit,
+                r.pipeline == rt::Pipeline::Megakernel ? "megakernel" : "wavefront",
+                r.meanTime * 1000, r.stddevTime * 1000, r.minTime * 1000, r.samplesPerSec, r.raysPerSec
+            );
+            out << line;
+        }
+        return;
+    }
+
+    std::string escapedDeviceName;
+    for (char c : deviceName) {
+        if (c == '"' || c == '\\') {
+            escapedDeviceName += '\\';
+        }
+        if (c != '\0') {
+            escapedDeviceName += c;
+        }
+    }
+
+    out << "{\n";
+    out << "  \"device\": \"" << escapedDeviceName << "\",\n";
+    out << "  \"warmup_iterations\": " << options.warmupIterations << ",\n";
+    out << "  \"iterations\": " << options.iterations << ",\n";
+    out << "  \"results\": [\n";
+    for (int i = 0; i < results.size(); i++) {
+        const CaseResult& r = results[i];
+        snprintf(
+            line, sizeof(line),
+            "    {\"scene\": %d, \"width\": %d, \"height\": %d, \"samples\": %u, \"bounces\": %u, \"pipeline\": \"%s\", "
+            "\"mean_ms\": %.4f, \"stddev_ms\": %.4f, \"min_ms\": %.4f, \"samples_per_sec\": %.1f, \"rays_per_sec\": %.1f}%s\n",
+            r.sceneIdx, r.resolution.x, r.resolution.y, r.config.sampleCount, r.config.bounceLimit,
+            r.pipeline == rt::Pipeline::Megakernel ? "megakernel" : "wavefront",
+            r.meanTime * 1000, r.stddevTime * 1000, r.minTime * 1000, r.samplesPerSec, r.raysPerSec,
+            i + 1 < results.size() ? "," : ""
+        );
+        out << line;
+    }
+    out << "  ]\n";
+    out << "}\n";
+}
+
+
+int main(int argc, char* argv[]) {
+    SuiteOptions options;
+    if (!parseOptions(argc, argv, options)) {
+        printf("%s", USAGE);
+        return 1;
+    }
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!rt::selectClDevice(rt::getDeviceSelectorFromEnv({.type = options.deviceType}), platform, device)) {
+        return 1;
+    }
+    std::string deviceName = rt::getClDeviceSummary(platform, device);
+    // progress goes to stderr so that stdout only has the results
+    fprintf(stderr, "Running on: %s\n", deviceName.c_str());
+
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+    auto scenes = createAllScenes(clObj.context, clObj.queue);
+
+    std::vector<CaseResult> results;
+    for (rt::Pipeline pipeline : options.pipelines) {
+        for (const glm::ivec2& resolution : options.resolutions) {
+            rt::Raytracer raytracer(resolution, clObj, rt::Format::RGBA32F, false, 0, pipeline);
+            raytracer.createClKernels();
+
+            for (const rt::Config& config : options.configs) {
+                for (int sceneIdx = 0; sceneIdx < scenes.size(); sceneIdx++) {
+                    fprintf(stderr, "scene %d, %dx%d, %u spp, %u bounces\n", sceneIdx, resolution.x, resolution.y, config.sampleCount, config.bounceLimit);
+                    CaseResult result = runCase(raytracer, scenes[sceneIdx], config, options);
+                    result.sceneIdx = sceneIdx;
+                    results.push_back(result);
+                }
+            }
+        }
+    }
+
+    if (options.outFilepath.empty()) {
+        writeResults(std::cout, results, options, deviceName);
+    } else {
+        std::ofstream file(options.outFilepath);
+        writeResults(file, results, options, deviceName);
+        fprintf(stderr, "Results written to %s\n", options.outFilepath.c_str());
+    }
+}
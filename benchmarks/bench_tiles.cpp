@@ -0,0 +1,51 @@
+
+#include "benchmarks/common.h"
+
+
+int main() {
+    const int imageWidth = 1920;
+    const int imageHeight = 1080;
+    const int iterations = 3;
+    const rt::Config config = {.sampleCount = 64, .bounceLimit = 5};
+    const int tileSizes[] = {64, 128, 256, 512};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, false);
+    raytracer.createClKernels(config);
+
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    auto scenes = createAllScenes(clObj.context, clObj.queue);
+    const auto& scene = scenes[7];
+
+    double singleTime = timeRenderScene(raytracer, scene, camera, config, 1, iterations);
+    printf("\n%16s | %10s | %10s\n", "mode", "time (ms)", "throughput");
+    printf("%16s | %10.3f | %9.2f%%\n", "single dispatch", singleTime * 1000, 100.0);
+
+    for (int tileSize : tileSizes) {
+        for (rt::TileOrder order : {rt::TileOrder::Scanline, rt::TileOrder::CenterOut}) {
+            rt::TiledRenderState state;
+            state.tileSize = {tileSize, tileSize};
+            state.order = order;
+
+            // warmup
+            raytracer.renderSceneTiled(scene, camera, config, state);
+
+            auto startTime = std::chrono::high_resolution_clock::now();
+            for (int i = 0; i < iterations; i++) {
+                state.reset();
+                raytracer.renderSceneTiled(scene, camera, config, state);
+            }
+            double tiledTime = getSecondsSince(startTime) / iterations;
+
+            char mode[32];
+            snprintf(mode, sizeof(mode), "%dx%d %s", tileSize, tileSize, order == rt::TileOrder::Scanline ? "scan" : "center");
+            printf("%16s | %10.3f | %9.2f%%\n", mode, tiledTime * 1000, 100.0 * singleTime / tiledTime);
+        }
+    }
+}
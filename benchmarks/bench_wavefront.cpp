@@ -0,0 +1,73 @@
+
+#include "benchmarks/common.h"
+
+
+struct PipelineResult {
+    double raysPerSec;
+    double samplesPerSec;
+    glm::vec3 meanColor;
+};
+
+
+static PipelineResult runPipeline(rt::Raytracer& raytracer, const rt::internal::Scene& scene, const rt::internal::Camera& camera, const rt::Config& config, int iterations) {
+    glm::ivec2 imageShape = raytracer.getImageShape();
+
+    raytracer.resetRayCount();
+    double timeTaken = timeRenderScene(raytracer, scene, camera, config, 1, iterations);
+    // the warmup render is counted as well
+    double raysPerRender = (double) raytracer.getRayCount() / (iterations + 1);
+
+    std::vector<glm::vec4> pixels(imageShape.x * imageShape.y);
+    raytracer.readPixels(pixels.data());
+    glm::vec3 meanColor = {0.0f, 0.0f, 0.0f};
+    for (const glm::vec4& pixel : pixels) {
+        meanColor += glm::vec3(pixel.r, pixel.g, pixel.b) / (float) pixels.size();
+    }
+
+    return {
+        .raysPerSec = raysPerRender / timeTaken,
+        .samplesPerSec = (double) imageShape.x * imageShape.y * config.sampleCount / timeTaken,
+        .meanColor = meanColor
+    };
+}
+
+
+int main() {
+    const int imageWidth = 640;
+    const int imageHeight = 360;
+    const int iterations = 5;
+    const rt::Config config = {.sampleCount = 16, .bounceLimit = 5};
+
+    cl::Platform platform;
+    cl::Device device;
+    if (!selectBenchmarkDevice(platform, device)) {
+        return 1;
+    }
+    rt::CL_Objects clObj = rt::createClObjects(platform, device);
+
+    rt::Raytracer megakernel({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, false, 0, rt::Pipeline::Megakernel);
+    rt::Raytracer wavefront({imageWidth, imageHeight}, clObj, rt::Format::RGBA32F, false, 0, rt::Pipeline::Wavefront);
+    megakernel.createClKernels(config);
+    wavefront.createClKernels(config);
+    megakernel.setRayCounting(true);
+    wavefront.setRayCounting(true);
+
+    auto camera = rt::createCamera(60.0f, {imageWidth, imageHeight}, {0, 0, 6}, {0, 0, -1});
+    auto scenes = createAllScenes(clObj.context, clObj.queue);
+
+    printf("\n%5s | %22s | %22s | %7s | %24s\n", "scene", "megakernel (Mrays/s)", "wavefront (Mrays/s)", "speedup", "mean color (mega / wave)");
+    for (int sceneIdx = 0; sceneIdx < scenes.size(); sceneIdx++) {
+        PipelineResult mega = runPipeline(megakernel, scenes[sceneIdx], camera, config, iterations);
+        PipelineResult wave = runPipeline(wavefront, scenes[sceneIdx], camera, config, iterations);
+
+        printf(
+            "%5d | %22.3f | %22.3f | %6.2fx | %.3f %.3f %.3f / %.3f %.3f %.3f\n",
+            sceneIdx,
+            mega.raysPerSec / 1'000'000,
+            wave.raysPerSec / 1'000'000,
+            wave.raysPerSec / mega.raysPerSec,
+            mega.meanColor.r, mega.meanColor.g, mega.meanColor.b,
+            wave.meanColor.r, wave.meanColor.g, wave.meanColor.b
+        );
+    }
+}
@@ -0,0 +1,66 @@
+
+#pragma once
+
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb/stb_image_write.h>
+
+#include "src/raytracer.h"
+#include "src/raytracer/camera.h"
+#include "src/test_scenes.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <vector>
+
+
+// a test scene and the label it is printed with
+struct NamedScene {
+    const char* name;
+    rt::Scene scene;
+};
+
+
+// device from the RT_CL_DEVICE env variable, otherwise the gpu (or any device) with the most compute units
+static bool selectBenchmarkDevice(cl::Platform& platform, cl::Device& device) {
+    if (!rt::selectClDevice(rt::getDeviceSelectorFromEnv(), platform, device)) {
+        return false;
+    }
+    printf("Device: %s\n", rt::getClDeviceSummary(platform, device).c_str());
+    return true;
+}
+
+
+static double getSecondsSince(std::chrono::high_resolution_clock::time_point startTime) {
+    auto timeTaken_ns = (std::chrono::high_resolution_clock::now() - startTime).count();
+    return (double) timeTaken_ns / 1'000'000'000;
+}
+
+
+// average seconds per `renderScene` call, after `warmupIterations` untimed calls
+static double timeRenderScene(rt::Raytracer& raytracer, const rt::internal::Scene& scene, const rt::internal::Camera& camera, const rt::Config& config, int warmupIterations, int iterations) {
+    for (int i = 0; i < warmupIterations; i++) {
+        raytracer.renderScene(scene, camera, config);
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        raytracer.renderScene(scene, camera, config);
+    }
+    return getSecondsSince(startTime) / iterations;
+}
+
+
+// of the [0, 1] clamped rgb channels
+static double computeRmse(const std::vector<float>& image, const std::vector<float>& reference) {
+    double squaredError = 0.0;
+    size_t numValues = 0;
+    for (size_t i = 0; i < image.size(); i++) {
+        if (i % 4 == 3) {
+            continue;
+        }
+        double delta = std::clamp(image[i], 0.0f, 1.0f) - std::clamp(reference[i], 0.0f, 1.0f);
+        squaredError += delta * delta;
+        numValues++;
+    }
+    return std::sqrt(squaredError / numValues);
+}
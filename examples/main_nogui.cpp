@@ -25,17 +25,19 @@ using namespace std::chrono;
 
 
 int main() {
-    // to select preffered gpu
-    const int clPlatformIdx = 0;
-    const int clDeviceIdx = 0;
     // window and image size
     const int imageWidth = 1280;
     const int imageHeight = 720;
     // number of samples per pixel
     const int sampleCount = 1024;
 
-    cl::Platform platform = rt::getAllClPlatforms()[clPlatformIdx];
-    cl::Device device = rt::getAllClDevices(platform)[clDeviceIdx];
+    // the device can be picked with the RT_CL_DEVICE env variable (gpu, cpu, <platformIdx>:<deviceIdx> or part of its name)
+    cl::Platform platform;
+    cl::Device device;
+    if (!rt::selectClDevice(rt::getDeviceSelectorFromEnv(), platform, device)) {
+        return 1;
+    }
+    printf("Using device: %s\n", rt::getClDeviceSummary(platform, device).c_str());
     rt::CL_Objects clObj = rt::createClObjects(platform, device);
 
     rt::Raytracer raytracer({imageWidth, imageHeight}, clObj, rt::Format::RGBA8, false);
@@ -45,7 +47,15 @@ int main() {
     auto scene = allScenes[7];
 
     RT_TIME_STMT("Time taken to compile cl prog:", raytracer.createClKernels({.sampleCount = sampleCount, .bounceLimit = 5}));
-    RT_TIME_STMT("Time taken to render:", raytracer.renderScene(scene, camera, {.sampleCount = sampleCount, .bounceLimit = 5}));
+    printf("Cl programs loaded from cache: %s\n", raytracer.areKernelsFromCache() ? "true" : "false");
+    // rendering in tiles so that a single dispatch doesn't hit the driver's watchdog
+    rt::TiledRenderState renderState;
+    auto printProgress = [](const rt::TileProgress& progress) {
+        printf("\rRendered tiles: %d/%d", progress.numCompletedTiles, progress.tileCount);
+        fflush(stdout);
+        return true;
+    };
+    RT_TIME_STMT("\nTime taken to render:", raytracer.renderSceneTiled(scene, camera, {.sampleCount = sampleCount, .bounceLimit = 5}, renderState, printProgress));
 
     printf("Image saved: %s\n", raytracer.saveAsImage("test.png") ? "true" : "false");
 }
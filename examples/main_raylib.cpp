@@ -3,6 +3,7 @@
 #include "src/backend/raylib/renderer.h"
 #include "src/backend/raylib/camera.h"
 #include "src/test_scenes.h"
+#include <deque>
 
 
 bool isSceneChanged() {
@@ -30,10 +31,37 @@ int getConfigIndex(int configCount) {
 }
 
 
+// frame latency (submit to completion) and throughput, averaged every second
+struct FrameStats {
+    double windowStartTime = 0.0;
+    double latencySum = 0.0;
+    int frameCount = 0;
+    double avgLatencyMs = 0.0;
+    double framesPerSec = 0.0;
+
+    void addFrame(double latency) {
+        latencySum += latency;
+        frameCount++;
+
+        double now = rl::GetTime();
+        if (now - windowStartTime >= 1.0) {
+            avgLatencyMs = latencySum / frameCount * 1000;
+            framesPerSec = frameCount / (now - windowStartTime);
+            windowStartTime = now;
+            latencySum = 0.0;
+            frameCount = 0;
+        }
+    }
+};
+
+
+struct FrameInFlight {
+    rt::FrameFence fence;
+    double submitTime;
+};
+
+
 int main(int argc, char* argv[]) {
-    // to select preffered gpu
-    const int clPlatformIdx = 0;
-    const int clDeviceIdx = 0;
     // window and image size
     const int displayWidth = 1280;
     const int displayHeight = 720;
@@ -43,12 +71,19 @@ int main(int argc, char* argv[]) {
     // kernel and display timers
     const int displayUpdatesPerSec = 30;
     const int kernelExecsPerSec = 30; // this also acts as FPS
+    // only with async frames (toggled with P)
+    const int maxFramesInFlight = 2;
 
     rl::SetTraceLogLevel(rl::LOG_WARNING);
     rl::InitWindow(displayWidth, displayHeight, "Raytracing [backend: raylib]");
 
-    cl::Platform platform = rt::getAllClPlatforms()[clPlatformIdx];
-    cl::Device device = rt::getAllClDevices(platform)[clDeviceIdx];
+    // the device can be picked with the RT_CL_DEVICE env variable (gpu, cpu, <platformIdx>:<deviceIdx> or part of its name)
+    cl::Platform platform;
+    cl::Device device;
+    if (!rt::selectClDevice(rt::getDeviceSelectorFromEnv(), platform, device)) {
+        return 1;
+    }
+    printf("Using device: %s\n", rt::getClDeviceSummary(platform, device).c_str());
     rt::CL_Objects clObj;
 
     bool clGlInterop = rt::supports_clGlInterop(device);
@@ -75,16 +110,30 @@ int main(int argc, char* argv[]) {
         {.sampleCount =  4, .bounceLimit = 5},
     };
 
-    for (int i = 0; i < sizeof(configs) / sizeof(rt::Config); i++) {
-        raytracer.createClKernels(configs[i]);
-    }
+    // every config can be used with the generic kernels, only the default one gets a specialised fast path
+    raytracer.createClKernels();
+    raytracer.createClKernels(configs[0]);
 
     int sceneIdx = 0;
     int configIdx = 0;
     int displayUpdateCount = 0;
     int kernelExecCount = 0;
 
+    bool asyncFrames = false;
+    std::deque<FrameInFlight> framesInFlight;
+    FrameStats frameStats;
+
     while (!rl::WindowShouldClose()) {
+        if (rl::IsKeyPressed(rl::KEY_P)) {
+            asyncFrames = !asyncFrames;
+            renderer.setAsyncReadback(asyncFrames);
+            for (const FrameInFlight& frame : framesInFlight) {
+                frame.fence.wait();
+            }
+            framesInFlight.clear();
+            frameStats = FrameStats();
+        }
+
         if (camera.update(rl::GetFrameTime()) || isSceneChanged()) {
             raytracer.resetFrameCount();
             sceneIdx = getSceneIndex(numScenes);
@@ -98,9 +147,23 @@ int main(int argc, char* argv[]) {
             renderer.update();
         }
 
-        kernelExecCount++;
-        raytracer.renderScene(scenes[sceneIdx], camera.getInternal(), configs[configIdx]);
-        raytracer.accumulatePixels();
+        if (asyncFrames) {
+            while (!framesInFlight.empty() && framesInFlight.front().fence.isComplete()) {
+                frameStats.addFrame(rl::GetTime() - framesInFlight.front().submitTime);
+                framesInFlight.pop_front();
+            }
+            if (framesInFlight.size() < maxFramesInFlight) {
+                kernelExecCount++;
+                double submitTime = rl::GetTime();
+                framesInFlight.push_back({raytracer.submitFrame(scenes[sceneIdx], camera.getInternal(), configs[configIdx]), submitTime});
+            }
+        } else {
+            kernelExecCount++;
+            double submitTime = rl::GetTime();
+            raytracer.renderScene(scenes[sceneIdx], camera.getInternal(), configs[configIdx]);
+            raytracer.accumulatePixels();
+            frameStats.addFrame(rl::GetTime() - submitTime);
+        }
 
         rl::BeginDrawing();
         rl::ClearBackground(rl::ORANGE);
@@ -111,7 +174,9 @@ int main(int argc, char* argv[]) {
         rl::DrawText(rl::TextFormat("Samples per pixel: %d", configs[configIdx].sampleCount * kernelExecCount), 10, 50, 18, rl::GREEN);
         rl::DrawText(rl::TextFormat("Current scene index: %d", sceneIdx), 10, 70, 18, rl::GREEN);
         rl::DrawText(rl::TextFormat("Config.sampleCount: %d", configs[configIdx].sampleCount), 10, 90, 18, rl::GREEN);
-        rl::DrawFPS(10, 110);
+        rl::DrawText(rl::TextFormat("Async frames [P]: %s", asyncFrames ? "on" : "off"), 10, 110, 18, rl::GREEN);
+        rl::DrawText(rl::TextFormat("Frame latency: %.2f ms, frames/sec: %.1f", frameStats.avgLatencyMs, frameStats.framesPerSec), 10, 130, 18, rl::GREEN);
+        rl::DrawFPS(10, 150);
         rl::EndDrawing();
     }
 }
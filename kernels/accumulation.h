@@ -0,0 +1,20 @@
+#ifndef ACCUMULATION_CL_H
+#define ACCUMULATION_CL_H
+
+
+// Running float32 mean of every pixel's color over the accumulated frames, `frameCount` starts at 1
+// the means are double buffered (the host swaps them once a frame is accumulated), so rendering a frame again replaces it
+// returns the color unchanged if accumulation is disabled (null buffers)
+float3 accumulateColor(global const float4* prevMeans, global float4* means, uint pixelIndex, uint frameCount, float3 color) {
+    if (means == 0) {
+        return color;
+    }
+
+    float3 mean = frameCount > 1 ? prevMeans[pixelIndex].xyz : (float3)(0.0f, 0.0f, 0.0f);
+    mean += (color - mean) / frameCount;
+    means[pixelIndex] = (float4)(mean, 1.0f);
+    return mean;
+}
+
+
+#endif
@@ -1,15 +1,77 @@
 
-kernel void accumulateFrameData(
-    read_only image2d_t frameImage,
-    read_write image2d_t accumImage,
-    uint numFrames, uint imgWidth
+// Regular accumulation is fused into the raytrace kernels (see kernels/accumulation.h), adaptive sampling
+// accumulates separately since every pixel has its own frame count
+
+#include "kernels/common.h"
+
+
+// pixels darker than this are held to the noise threshold of a pixel this bright
+#define ADAPTIVE_MIN_LUMINANCE 0.01f
+
+
+// Averages the frame into the pixels of active tiles (the only ones rendered this frame)
+// every pixel keeps its own frame count, and the running mean and sum of squared differences of its luminance (Welford)
+// the frame and the mean stay float32, `accumImage` only gets the mean converted to the output format
+kernel void accumulateAdaptive(
+    global const float4* frameColors,
+    global float4* means,
+    write_only image2d_t accumImage,
+    global float4* pixelStats,
+    global const uint* activeTiles,
+    int2 tileSize, uint imgWidth
 ) {
     size_t pixelIdx = get_global_id(0);
     int2 imgCoords = {pixelIdx % imgWidth, pixelIdx / imgWidth};
+    uint tilesPerRow = (imgWidth + tileSize.x - 1) / tileSize.x;
+    if (!activeTiles[(imgCoords.y / tileSize.y) * tilesPerRow + imgCoords.x / tileSize.x]) {
+        return;
+    }
+
+    // {frames, mean luminance, sum of squared differences, unused}
+    float4 stats = pixelStats[pixelIdx];
+    float3 frameColor = frameColors[pixelIdx].xyz;
+    float luminance = getLuminance(frameColor);
+    stats.x += 1.0f;
+    float delta = luminance - stats.y;
+    stats.y += delta / stats.x;
+    stats.z += delta * (luminance - stats.y);
+    pixelStats[pixelIdx] = stats;
+
+    float3 mean = stats.x > 1.0f ? means[pixelIdx].xyz : (float3)(0.0f, 0.0f, 0.0f);
+    mean += (frameColor - mean) / stats.x;
+    means[pixelIdx] = (float4)(mean, 1.0f);
+    write_imagef(accumImage, imgCoords, (float4)(mean, 1.0f));
+}
+
+
+// A tile stays active while the standard error of the mean of any of its pixels is above `threshold` (relative to the mean)
+// or until it has `minFrames` frames, converged tiles are never reactivated
+kernel void updateActiveTiles(
+    global const float4* pixelStats,
+    global uint* activeTiles,
+    int2 imgSize, int2 tileSize,
+    float threshold, uint minFrames
+) {
+    uint tileIdx = get_global_id(0);
+    if (!activeTiles[tileIdx]) {
+        return;
+    }
+
+    uint tilesPerRow = (imgSize.x + tileSize.x - 1) / tileSize.x;
+    int2 origin = (int2)(tileIdx % tilesPerRow, tileIdx / tilesPerRow) * tileSize;
+    int2 end = min(origin + tileSize, imgSize);
 
-    float4 frameColor = read_imagef(frameImage, imgCoords);
-    float4 accumColor = read_imagef(accumImage, imgCoords);
-    float4 avgColor = (accumColor * (numFrames - 1) + frameColor) / numFrames;
+    float maxError = 0.0f;
+    float frames = 0.0f;
+    for (int y = origin.y; y < end.y; y++) {
+        for (int x = origin.x; x < end.x; x++) {
+            float4 stats = pixelStats[y * imgSize.x + x];
+            float variance = stats.z / fmax(stats.x - 1.0f, 1.0f);
+            float error = sqrt(variance / stats.x) / fmax(stats.y, ADAPTIVE_MIN_LUMINANCE);
+            maxError = fmax(maxError, error);
+            frames = stats.x;
+        }
+    }
 
-    write_imagef(accumImage, imgCoords, avgColor);
+    activeTiles[tileIdx] = frames < minFrames || maxError > threshold;
 }
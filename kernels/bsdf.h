@@ -0,0 +1,146 @@
+
+#ifndef BSDF_CL_H
+#define BSDF_CL_H
+
+#include "kernels/common.h"
+#include "kernels/sampler.h"
+
+// A material is a mix of a Lambertian lobe and a GGX (Trowbridge-Reitz) specular lobe tinted by its color,
+// weighted by the smoothness, which also sets the roughness of the specular lobe
+// directions point away from the surface, `wo` towards the viewer and `wi` towards the light
+
+// keeps the microfacet distribution finite for perfect mirrors
+#define BSDF_MIN_ALPHA 0.001f
+
+
+typedef struct {
+    float3 direction;
+    // bsdf * cos / pdf
+    float3 weight;
+    // of both lobes
+    float pdf;
+} rt_BsdfSample;
+
+
+float3 reflect(float3 I, float3 N) {
+    return I - 2.0f * dot(N, I) * N;
+}
+
+
+// Orthonormal basis around `n` (Duff et al. 2017)
+void buildBasis(float3 n, float3* t, float3* b) {
+    float sign = n.z >= 0.0f ? 1.0f : -1.0f;
+    float a = -1.0f / (sign + n.z);
+    float c = n.x * n.y * a;
+    *t = (float3)(1.0f + sign * n.x * n.x * a, sign * c, -sign * n.x);
+    *b = (float3)(c, sign + n.y * n.y * a, -n.y);
+}
+
+
+float ggxAlpha(global const rt_Material* material) {
+    float roughness = 1.0f - material->smoothness;
+    return fmax(roughness * roughness, BSDF_MIN_ALPHA);
+}
+
+
+// `cosTheta` is with the normal (of the macro surface or of a microfacet)
+float ggxD(float cosTheta, float alpha) {
+    float a2 = alpha * alpha;
+    float d = cosTheta * cosTheta * (a2 - 1.0f) + 1.0f;
+    return a2 / (M_PI_F * d * d);
+}
+
+
+// Smith's masking term, G1 = 1 / (1 + lambda)
+float ggxLambda(float cosTheta, float alpha) {
+    float cos2 = cosTheta * cosTheta;
+    float tan2 = fmax(1.0f - cos2, 0.0f) / cos2;
+    return 0.5f * (sqrt(1.0f + alpha * alpha * tan2) - 1.0f);
+}
+
+
+float3 fresnelSchlick(float3 f0, float cosTheta) {
+    float m = 1.0f - clamp(cosTheta, 0.0f, 1.0f);
+    float m2 = m * m;
+    return f0 + (1.0f - f0) * (m2 * m2 * m);
+}
+
+
+// Samples the microfacet normals visible from `wo`, in the local frame with z up (Heitz 2018)
+float3 sampleGgxVisibleNormal(float3 wo, float alpha, float u1, float u2) {
+    float3 vh = normalize((float3)(alpha * wo.x, alpha * wo.y, wo.z));
+    float lengthSquared = vh.x * vh.x + vh.y * vh.y;
+    float3 t1 = lengthSquared > 0.0f ? (float3)(-vh.y, vh.x, 0.0f) * rsqrt(lengthSquared) : (float3)(1.0f, 0.0f, 0.0f);
+    float3 t2 = cross(vh, t1);
+
+    float r = sqrt(u1);
+    float phi = 2.0f * M_PI_F * u2;
+    float p1 = r * cos(phi);
+    float p2 = r * sin(phi);
+    float s = 0.5f * (1.0f + vh.z);
+    p2 = (1.0f - s) * sqrt(fmax(1.0f - p1 * p1, 0.0f)) + s * p2;
+
+    float3 nh = p1 * t1 + p2 * t2 + sqrt(fmax(1.0f - p1 * p1 - p2 * p2, 0.0f)) * vh;
+    return normalize((float3)(alpha * nh.x, alpha * nh.y, fmax(nh.z, 0.0f)));
+}
+
+
+// Returns bsdf * cos for the pair of directions and writes the pdf `sampleBsdf` has of picking `wi`
+// `n` must face `wo`
+float3 evaluateBsdf(global const rt_Material* material, float3 n, float3 wo, float3 wi, float* pdf) {
+    float cosO = dot(n, wo);
+    float cosI = dot(n, wi);
+    if (cosO <= 0.0f || cosI <= 0.0f) {
+        *pdf = 0.0f;
+        return (float3)(0.0f, 0.0f, 0.0f);
+    }
+
+    float specularProbability = material->smoothness;
+    float diffusePdf = cosI * M_1_PI_F;
+    float3 diffuse = material->color * diffusePdf;
+
+    float alpha = ggxAlpha(material);
+    float3 h = normalize(wo + wi);
+    float d = ggxD(dot(n, h), alpha);
+    float lambdaO = ggxLambda(cosO, alpha);
+    float lambdaI = ggxLambda(cosI, alpha);
+    float3 specular = fresnelSchlick(material->color, dot(wo, h)) * (d / ((1.0f + lambdaO + lambdaI) * 4.0f * cosO));
+    // the visible normal pdf, divided by the jacobian of the reflection
+    float specularPdf = d / ((1.0f + lambdaO) * 4.0f * cosO);
+
+    *pdf = mix(diffusePdf, specularPdf, specularProbability);
+    return mix(diffuse, specular, specularProbability);
+}
+
+
+// Picks a lobe, then a direction from it, takes a 2D sample and one dimension
+// returns false if the sampled direction doesn't leave the surface
+bool sampleBsdf(global const rt_Material* material, float3 n, float3 wo, rt_Sampler* sampler, rt_BsdfSample* sample) {
+    float2 u = sample2D(sampler);
+    float u1 = u.x;
+    float u2 = u.y;
+    float lobe = sampleFloat(sampler);
+
+    float3 t, b;
+    buildBasis(n, &t, &b);
+    if (lobe < material->smoothness) {
+        float3 woLocal = (float3)(dot(wo, t), dot(wo, b), dot(wo, n));
+        float3 h = sampleGgxVisibleNormal(woLocal, ggxAlpha(material), u1, u2);
+        sample->direction = reflect(-wo, h.x * t + h.y * b + h.z * n);
+    } else {
+        // cosine weighted
+        float r = sqrt(u1);
+        float phi = 2.0f * M_PI_F * u2;
+        sample->direction = r * cos(phi) * t + r * sin(phi) * b + sqrt(fmax(1.0f - u1, 0.0f)) * n;
+    }
+
+    float3 value = evaluateBsdf(material, n, wo, sample->direction, &sample->pdf);
+    if (sample->pdf <= 0.0f) {
+        return false;
+    }
+    sample->weight = value / sample->pdf;
+    return true;
+}
+
+
+#endif
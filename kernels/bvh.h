@@ -0,0 +1,71 @@
+
+#ifndef BVH_CL_H
+#define BVH_CL_H
+
+#include "kernels/common.h"
+
+// the host limits the depth of every bvh (RT_BVH_MAX_DEPTH), so a traversal never pushes more than this
+#define BVH_STACK_SIZE 64
+
+
+// if count == 0, leftFirst is the index of the left child (right child is leftFirst + 1)
+// otherwise it is the index of the first object of the leaf
+typedef struct {
+    float3 boundsMin;
+    float3 boundsMax;
+    uint leftFirst;
+    uint count;
+} rt_BvhNode;
+
+
+// returns the entry distance, FLT_MAX if the box is missed or farther than `maxDistance`
+float hitsAabb(float3 boundsMin, float3 boundsMax, const rt_Ray* ray, float3 invDirection, float maxDistance) {
+    float3 t0 = (boundsMin - ray->origin) * invDirection;
+    float3 t1 = (boundsMax - ray->origin) * invDirection;
+    float3 tSmall = fmin(t0, t1);
+    float3 tBig = fmax(t0, t1);
+    float tNear = fmax(fmax(tSmall.x, tSmall.y), tSmall.z);
+    float tFar = fmin(fmin(tBig.x, tBig.y), tBig.z);
+
+    if (tFar >= tNear && tFar > 0.0f && tNear < maxDistance) {
+        return tNear;
+    }
+    return FLT_MAX;
+}
+
+
+// next node to visit once a leaf is done, returns false if the stack is empty
+bool popBvhStack(uint* stack, uint* stackSize, uint* nodeIdx) {
+    if (*stackSize == 0) {
+        return false;
+    }
+    *nodeIdx = stack[--(*stackSize)];
+    return true;
+}
+
+
+// moves to the nearer child of an interior node, the farther one is pushed on the stack
+// returns false once there is nothing left to visit
+bool descendBvhNode(global const rt_BvhNode* bvhNodes, global const rt_BvhNode* node, const rt_Ray* ray, float3 invDirection, float maxDistance, uint* stack, uint* stackSize, uint* nodeIdx) {
+    uint nearIdx = node->leftFirst;
+    uint farIdx = node->leftFirst + 1;
+    float nearDist = hitsAabb(bvhNodes[nearIdx].boundsMin, bvhNodes[nearIdx].boundsMax, ray, invDirection, maxDistance);
+    float farDist = hitsAabb(bvhNodes[farIdx].boundsMin, bvhNodes[farIdx].boundsMax, ray, invDirection, maxDistance);
+    if (nearDist > farDist) {
+        uint tempIdx = nearIdx; nearIdx = farIdx; farIdx = tempIdx;
+        float tempDist = nearDist; nearDist = farDist; farDist = tempDist;
+    }
+
+    if (nearDist == FLT_MAX) {
+        return popBvhStack(stack, stackSize, nodeIdx);
+    }
+
+    *nodeIdx = nearIdx;
+    if (farDist != FLT_MAX) {
+        stack[(*stackSize)++] = farIdx;
+    }
+    return true;
+}
+
+
+#endif
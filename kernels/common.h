@@ -12,6 +12,8 @@ typedef struct {
 typedef struct {
     float3 worldPosition;
     float3 worldNormal;
+    // of the surface itself (not interpolated), outward for spheres and facing the ray for triangles
+    float3 geometricNormal;
     float hitDistance;
     uint materialIndex;
 } rt_HitRecord;
@@ -24,4 +26,9 @@ typedef struct {
 } rt_Material;
 
 
+float getLuminance(float3 color) {
+    return dot(color, (float3)(0.2126f, 0.7152f, 0.0722f));
+}
+
+
 #endif
@@ -0,0 +1,27 @@
+
+#ifndef CONFIG_CL_H
+#define CONFIG_CL_H
+
+// The sample count, bounce limit and roulette depth are kernel arguments, unless the program is specialised
+// for a config by defining CONFIG__SAMPLE_COUNT, CONFIG__BOUNCE_LIMIT and CONFIG__ROULETTE_DEPTH (lets the compiler unroll)
+
+#ifdef CONFIG__SAMPLE_COUNT
+#define SAMPLE_COUNT(arg) CONFIG__SAMPLE_COUNT
+#else
+#define SAMPLE_COUNT(arg) (arg)
+#endif
+
+#ifdef CONFIG__BOUNCE_LIMIT
+#define BOUNCE_LIMIT(arg) CONFIG__BOUNCE_LIMIT
+#else
+#define BOUNCE_LIMIT(arg) (arg)
+#endif
+
+#ifdef CONFIG__ROULETTE_DEPTH
+#define ROULETTE_DEPTH(arg) CONFIG__ROULETTE_DEPTH
+#else
+#define ROULETTE_DEPTH(arg) (arg)
+#endif
+
+
+#endif
@@ -0,0 +1,51 @@
+#include "kernels/common.h"
+
+
+// 1D B3 spline, the 5x5 filter is its outer product
+constant float ATROUS_WEIGHTS[3] = {3.0f / 8.0f, 1.0f / 4.0f, 1.0f / 16.0f};
+
+
+float getEdgeWeight(float3 a, float3 b, float phi) {
+    float3 delta = a - b;
+    return exp(-dot(delta, delta) / phi);
+}
+
+
+// One iteration of the edge avoiding a-trous wavelet filter (Dammertz et al. 2010)
+// taps are `stepWidth` pixels apart and weighted down across color, normal and albedo edges
+kernel void atrousFilter(
+    read_only image2d_t in,
+    write_only image2d_t out,
+    global const float4* albedoAovs,
+    global const float4* normalAovs,
+    int stepWidth,
+    float colorPhi, float normalPhi, float albedoPhi
+) {
+    int2 imgCoords = {get_global_id(0), get_global_id(1)};
+    int2 imgSize = get_image_dim(in);
+    uint pixelIdx = imgCoords.y * imgSize.x + imgCoords.x;
+
+    float3 centerColor = read_imagef(in, imgCoords).xyz;
+    float3 centerNormal = normalAovs[pixelIdx].xyz;
+    float3 centerAlbedo = albedoAovs[pixelIdx].xyz;
+
+    float3 colorSum = {0.0f, 0.0f, 0.0f};
+    float weightSum = 0.0f;
+    for (int dy = -2; dy <= 2; dy++) {
+        for (int dx = -2; dx <= 2; dx++) {
+            int2 coords = clamp(imgCoords + (int2)(dx, dy) * stepWidth, (int2)(0, 0), imgSize - 1);
+            uint idx = coords.y * imgSize.x + coords.x;
+            float3 color = read_imagef(in, coords).xyz;
+
+            float weight = ATROUS_WEIGHTS[abs(dx)] * ATROUS_WEIGHTS[abs(dy)];
+            weight *= getEdgeWeight(color, centerColor, colorPhi);
+            weight *= getEdgeWeight(normalAovs[idx].xyz, centerNormal, normalPhi);
+            weight *= getEdgeWeight(albedoAovs[idx].xyz, centerAlbedo, albedoPhi);
+            colorSum += color * weight;
+            weightSum += weight;
+        }
+    }
+
+    // the center tap always has a weight, so `weightSum` can't be 0
+    write_imagef(out, imgCoords, (float4)(colorSum / weightSum, 1.0f));
+}
@@ -0,0 +1,109 @@
+
+#ifndef LIGHTS_CL_H
+#define LIGHTS_CL_H
+
+#include "kernels/common.h"
+#include "kernels/sampler.h"
+#include "kernels/scene.h"
+#include "kernels/bsdf.h"
+
+// Next event estimation: every hit also connects to a point on an emitter with a shadow ray
+// emitters are picked in proportion to their power and sampled uniformly by area, so the area pdf of any
+// emitter point only depends on its emission (see `getEmitterPdf`), both for light samples and for bsdf rays hitting it
+// the two strategies are combined with multiple importance sampling (power heuristic)
+
+// shadow rays stop this fraction short of the light, so that they don't hit the emitter itself
+#define SHADOW_RAY_SHORTENING 0.999f
+
+
+float powerHeuristic(float pdf, float otherPdf) {
+    float a = pdf * pdf;
+    float b = otherPdf * otherPdf;
+    return a + b > 0.0f ? a / (a + b) : 0.0f;
+}
+
+
+// in area measure, zero for surfaces that aren't in the emitter list
+float getEmitterPdf(const rt_SceneParams* scene, float3 emission) {
+    return getLuminance(emission) * scene->emitterPdfScale;
+}
+
+
+// the first emitter whose cdf is above `u`
+uint pickEmitter(global const rt_Emitter* emitters, uint emitterCount, float u) {
+    uint first = 0;
+    uint last = emitterCount - 1;
+    while (first < last) {
+        uint middle = (first + last) / 2;
+        if (emitters[middle].cdf <= u) {
+            first = middle + 1;
+        } else {
+            last = middle;
+        }
+    }
+    return first;
+}
+
+
+// a uniform point on the emitter and its (outward for spheres) normal
+void sampleEmitter(global const rt_Emitter* emitter, float u1, float u2, float3* point, float3* normal) {
+    if (emitter->isSphere) {
+        float z = 1.0f - 2.0f * u1;
+        float phi = 2.0f * M_PI_F * u2;
+        float r = sqrt(fmax(0.0f, 1.0f - z * z));
+        *normal = (float3)(r * cos(phi), r * sin(phi), z);
+        *point = emitter->v0 + emitter->edge1.x * *normal;
+        return;
+    }
+
+    float su = sqrt(u1);
+    *point = emitter->v0 + su * (1.0f - u2) * emitter->edge1 + su * u2 * emitter->edge2;
+    *normal = normalize(cross(emitter->edge1, emitter->edge2));
+}
+
+
+// Light arriving at the hit from a sampled emitter point, times the bsdf and its mis weight, takes a 2D sample and one dimension
+// `normal` must face `wo`
+float3 sampleDirectLight(const rt_HitRecord* record, float3 normal, float3 wo, global const rt_Material* material, const rt_SceneParams* scene, const rt_SceneGeometry* geometry, rt_Sampler* sampler, uint* rayCount) {
+    float2 uv = sample2D(sampler);
+    float u1 = uv.x;
+    float u2 = uv.y;
+    float u = sampleFloat(sampler);
+    float3 black = {0.0f, 0.0f, 0.0f};
+
+    global const rt_Emitter* emitter = &geometry->emitters[pickEmitter(geometry->emitters, scene->emitterCount, u)];
+    float3 lightPoint, lightNormal;
+    sampleEmitter(emitter, u1, u2, &lightPoint, &lightNormal);
+
+    float3 origin = record->worldPosition + normal * 0.001f;
+    float3 toLight = lightPoint - origin;
+    float distanceSquared = dot(toLight, toLight);
+    float distance = sqrt(distanceSquared);
+    float3 wi = toLight / distance;
+
+    // triangles emit from both sides, the far side of a sphere is hidden by the sphere itself
+    float cosLight = dot(lightNormal, -wi);
+    cosLight = emitter->isSphere ? cosLight : fabs(cosLight);
+    if (cosLight <= 0.0f) {
+        return black;
+    }
+
+    float bsdfPdf;
+    float3 bsdf = evaluateBsdf(material, normal, wo, wi, &bsdfPdf);
+    if (bsdfPdf <= 0.0f) {
+        return black;
+    }
+
+    rt_Ray shadowRay = {origin, wi};
+    (*rayCount)++;
+    if (occluded(&shadowRay, distance * SHADOW_RAY_SHORTENING, scene, geometry)) {
+        return black;
+    }
+
+    // converted to solid angle
+    float lightPdf = getEmitterPdf(scene, emitter->emission) * distanceSquared / cosLight;
+    return bsdf * emitter->emission * (powerHeuristic(lightPdf, bsdfPdf) / lightPdf);
+}
+
+
+#endif
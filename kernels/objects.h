@@ -1,33 +1,97 @@
-
 #ifndef OBJECTS_CL_H
 #define OBJECTS_CL_H
 
 #include "kernels/sphere.h"
 #include "kernels/triangle.h"
+#include "kernels/bvh.h"
+
+
+// indices into the vertex buffer
+typedef struct {
+    uint v0;
+    uint v1;
+    uint v2;
+    uint materialIndex;
+} rt_TriangleIndices;
 
-#define OBJECT_TYPE_SPHERE 0
-#define OBJECT_TYPE_TRIANGLE 1
 
+// instance materialIndex that keeps the materials of the mesh's triangles
+#define INSTANCE_MESH_MATERIAL 0xFFFFFFFF
 
+// a mesh (its bvh in `bvhNodes`) placed in the scene with its own transform
 typedef struct {
-    union {
-        rt_Sphere sphere;
-        rt_Triangle triangle;
-    };
-    uint type;
+    // rows of the affine world to object transform
+    float4 worldToObject[3];
+    uint bvhRoot;
     uint materialIndex;
-} rt_Object;
+} rt_Instance;
+
+
+// a primitive with an emissive material, in world space (instanced triangles too)
+typedef struct {
+    // first vertex of a triangle, or center of a sphere
+    float3 v0;
+    // edges v0v1 and v0v2 of a triangle, or (radius, 0, 0) and zero for a sphere
+    float3 edge1;
+    float3 edge2;
+    float3 emission;
+    // sum of the power of the emitters up to this one, over the total power
+    float cdf;
+    uint isSphere;
+} rt_Emitter;
+
+
+// one compact buffer per primitive type, every bvh is in `bvhNodes`
+typedef struct {
+    global const rt_Sphere* spheres;
+    global const float3* vertices;
+    // per vertex, null if the scene has no smooth shaded meshes
+    global const float3* normals;
+    global const rt_TriangleIndices* triangles;
+    global const rt_BvhNode* bvhNodes;
+    global const rt_Instance* instances;
+    // only read for light sampling, null if the scene has no emitters
+    global const rt_Emitter* emitters;
+} rt_SceneGeometry;
 
 
-bool hitsObject(const rt_Object object, const rt_Ray* ray, rt_HitRecord* record) {
-    switch (object.type) {
-        case OBJECT_TYPE_SPHERE:
-            return hitsSphere(&object.sphere, ray, record);
-        case OBJECT_TYPE_TRIANGLE:
-            return hitsTriangle(&object.triangle, ray, record);
-        default:
-            return false;
+float3 transformPoint(global const float4* rows, float3 point) {
+    float4 p = (float4)(point, 1.0f);
+    return (float3)(dot(rows[0], p), dot(rows[1], p), dot(rows[2], p));
+}
+
+
+float3 transformDirection(global const float4* rows, float3 direction) {
+    return (float3)(dot(rows[0].xyz, direction), dot(rows[1].xyz, direction), dot(rows[2].xyz, direction));
+}
+
+
+float getIndexedTriangleDistance(const rt_SceneGeometry* geometry, const rt_TriangleIndices indices, const rt_Ray* ray) {
+    global const float3* vertices = geometry->vertices;
+    const rt_Triangle triangle = {vertices[indices.v0], vertices[indices.v1], vertices[indices.v2]};
+    float2 barycentrics;
+    return getTriangleDistance(&triangle, ray, &barycentrics);
+}
+
+
+bool hitsIndexedTriangle(const rt_SceneGeometry* geometry, const rt_TriangleIndices indices, const rt_Ray* ray, rt_HitRecord* record) {
+    global const float3* vertices = geometry->vertices;
+    const rt_Triangle triangle = {vertices[indices.v0], vertices[indices.v1], vertices[indices.v2]};
+    float2 barycentrics;
+    if (!hitsTriangle(&triangle, ray, record, &barycentrics)) {
+        return false;
+    }
+
+    // interpolated vertex normals, vertices without one are zero so the face normal is kept
+    if (geometry->normals != 0) {
+        global const float3* normals = geometry->normals;
+        float3 normal = (1.0f - barycentrics.x - barycentrics.y) * normals[indices.v0] + barycentrics.x * normals[indices.v1] + barycentrics.y * normals[indices.v2];
+        if (dot(normal, normal) > 0.0f) {
+            normal = normalize(normal);
+            record->worldNormal = dot(ray->direction, normal) > 0.0f ? -normal : normal;
+        }
     }
+    return true;
 }
 
 
@@ -10,27 +10,4 @@ uint pcgHash(uint input) {
 }
 
 
-float randomFloat(uint* seed) {
-    *seed = pcgHash(*seed);
-    return (float) *seed / UINT_MAX;
-}
-
-
-float randomNormalFloat(uint* seed) {
-    float theta = 2.0f * M_PI_F * randomFloat(seed);
-    float rho = sqrt(-2.0f * log(randomFloat(seed)));
-    return rho * cos(theta);
-}
-
-
-float3 randomFloat3(uint* seed) {
-    float3 p = {
-        randomNormalFloat(seed),
-        randomNormalFloat(seed),
-        randomNormalFloat(seed)
-    };
-    return normalize(p);
-}
-
-
 #endif
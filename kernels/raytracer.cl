@@ -1,58 +1,33 @@
 
+#include "kernels/config.h"
 #include "kernels/common.h"
-#include "kernels/random.h"
-#include "kernels/objects.h"
+#include "kernels/sampler.h"
+#include "kernels/scene.h"
+#include "kernels/shading.h"
 #include "kernels/ray_gen.h"
+#include "kernels/stats.h"
+#include "kernels/accumulation.h"
 
 
-typedef struct {
-    float3 backgroundColor;
-    uint objectCount;
-} rt_SceneParams;
-
-
-float3 reflect(float3 I, float3 N) {
-    return I - 2.0f * dot(N, I) * N;
-}
-
-
-rt_HitRecord traceRay(const rt_Ray* ray, const rt_SceneParams* scene, global const rt_Object* objects) {
-    rt_HitRecord record;
-    record.hitDistance = FLT_MAX;
-
-    for (int i = 0; i < scene->objectCount; i++) {
-        const rt_Object object = objects[i];
-        if (hitsObject(object, ray, &record)) {
-            record.materialIndex = object.materialIndex;
-        }
-    }
-
-    return record;
-}
-
-
-float3 perPixel(rt_Ray ray, const rt_SceneParams* scene, global const rt_Object* objects, global const rt_Material* materials, uint* rngSeed) {
+// `firstHit` gets the record of the camera ray
+float3 perPixel(rt_Ray ray, const rt_SceneParams* scene, const rt_SceneGeometry* geometry, global const rt_Material* materials, uint bounceLimit, uint rouletteDepth, rt_Sampler* sampler, uint* rayCount, rt_HitRecord* firstHit) {
     float3 light = {0.0f, 0.0f, 0.0f};
     float3 contribution = {1.0f, 1.0f, 1.0f};
+    float bsdfPdf = 0.0f;
 
-    for (int i = 0; i < CONFIG__BOUNCE_LIMIT; i++) {
-        rngSeed += i * i * i;
-        rt_HitRecord record = traceRay(&ray, scene, objects);
+    for (int i = 0; i < BOUNCE_LIMIT(bounceLimit); i++) {
+        rt_HitRecord record = traceRay(&ray, scene, geometry);
+        (*rayCount)++;
+        if (i == 0) {
+            *firstHit = record;
+        }
 
-        if (record.hitDistance == FLT_MAX) {
-            light += scene->backgroundColor * contribution;
+        if (!shadeHit(&ray, &record, scene, geometry, materials, &light, &contribution, &bsdfPdf, sampler, rayCount)) {
+            break;
+        }
+        if (!survivesRoulette(&contribution, i + 1, ROULETTE_DEPTH(rouletteDepth), sampler)) {
             break;
         }
-
-        global const rt_Material* material = &materials[record.materialIndex];
-
-        light += material->emissionColor * contribution;
-        contribution *= material->color;
-
-        float3 diffuseDir = normalize(record.worldNormal + randomFloat3(rngSeed));
-        float3 specularDir = reflect(ray.direction, record.worldNormal);
-        ray.origin = record.worldPosition + record.worldNormal * 0.001f;
-        ray.direction = normalize(mix(diffuseDir, specularDir, material->smoothness));
     }
 
     return light;
@@ -62,26 +37,51 @@ float3 perPixel(rt_Ray ray, const rt_SceneParams* scene, global const rt_Object*
 kernel void raytraceScene(
     const rt_Camera camera,
     const rt_SceneParams scene,
-    global const rt_Object* objects,
+    global const rt_Sphere* spheres,
+    global const float3* vertices,
+    global const float3* normals,
+    global const rt_TriangleIndices* triangles,
     global const rt_Material* materials,
-    uint initialRngSeed,
+    global const rt_BvhNode* bvhNodes,
+    global const rt_Instance* instances,
+    global const rt_Emitter* emitters,
+    uint firstSampleIndex,
+    uint sampleCount,
+    uint bounceLimit,
+    uint rouletteDepth,
+    global uint* rayCounter,
+    global float4* albedoAovs,
+    global float4* normalAovs,
+    global const float4* prevMeans,
+    global float4* means,
+    uint frameCount,
     write_only image2d_t out
 ) {
-    uint pixelIndex = get_global_id(0);
+    // launched over (a region of) the image with a 2D range
+    uint pixelIndex = get_global_id(1) * camera.imageSize.x + get_global_id(0);
 
-    uint rngSeed = (pixelIndex + 1) * initialRngSeed;
+    uint rayCount = 0;
 
     float3 accumulatedFrameColor = {0.0f, 0.0f, 0.0f};
 
     rt_Ray ray = getRay(&camera, pixelIndex);
-
-    for (int frameIndex = 0; frameIndex < CONFIG__SAMPLE_COUNT; frameIndex++) {
-        rngSeed += frameIndex * 32421;
-        accumulatedFrameColor += perPixel(ray, &scene, objects, materials, &rngSeed);
+    const rt_SceneGeometry geometry = {spheres, vertices, normals, triangles, bvhNodes, instances, emitters};
+
+    // camera rays don't change between samples, so the features come from the first one
+    rt_HitRecord firstHit;
+    for (int frameIndex = 0; frameIndex < SAMPLE_COUNT(sampleCount); frameIndex++) {
+        rt_Sampler sampler = createSampler(pixelIndex, firstSampleIndex + frameIndex);
+        accumulatedFrameColor += perPixel(ray, &scene, &geometry, materials, bounceLimit, rouletteDepth, &sampler, &rayCount, &firstHit);
+        if (frameIndex == 0) {
+            writeAovs(albedoAovs, normalAovs, pixelIndex, &firstHit, &scene, materials);
+        }
     }
-    accumulatedFrameColor = accumulatedFrameColor / CONFIG__SAMPLE_COUNT;
+    accumulatedFrameColor = accumulatedFrameColor / SAMPLE_COUNT(sampleCount);
+    addToCounter(rayCounter, rayCount);
 
+    // with accumulation `out` gets the mean over the frames, converted to its format as it is written
+    float3 color = accumulateColor(prevMeans, means, pixelIndex, frameCount, accumulatedFrameColor);
     int2 imgCoords = {pixelIndex % camera.imageSize.x, pixelIndex / camera.imageSize.x};
-    float4 imgColor = {accumulatedFrameColor.xyz, 1.0f};
+    float4 imgColor = {color, 1.0f};
     write_imagef(out, imgCoords, imgColor);
 }
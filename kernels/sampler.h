@@ -0,0 +1,117 @@
+
+#ifndef SAMPLER_CL_H
+#define SAMPLER_CL_H
+
+#include "kernels/random.h"
+
+// The sampler is picked when the program is built: Owen scrambled Sobol points by default,
+// or independent random numbers if CONFIG__SAMPLER_RANDOM is defined
+
+// dimensions of the Sobol sequence used, the later dimensions of a path reuse them with a different shuffle
+#define SOBOL_DIMENSIONS 4
+
+
+// Samples of a pixel are numbered over every accumulated frame, every random decision of a path takes the next dimension
+typedef struct {
+    uint seed;
+    uint sampleIndex;
+    uint dimension;
+} rt_Sampler;
+
+
+// direction numbers of the Sobol dimensions 1 to 3 (Joe and Kuo), dimension 0 is the van der Corput sequence
+constant uint SOBOL_DIRECTIONS[SOBOL_DIMENSIONS - 1][32] = {
+    {
+        0x80000000, 0xc0000000, 0xa0000000, 0xf0000000, 0x88000000, 0xcc000000, 0xaa000000, 0xff000000,
+        0x80800000, 0xc0c00000, 0xa0a00000, 0xf0f00000, 0x88880000, 0xcccc0000, 0xaaaa0000, 0xffff0000,
+        0x80008000, 0xc000c000, 0xa000a000, 0xf000f000, 0x88008800, 0xcc00cc00, 0xaa00aa00, 0xff00ff00,
+        0x80808080, 0xc0c0c0c0, 0xa0a0a0a0, 0xf0f0f0f0, 0x88888888, 0xcccccccc, 0xaaaaaaaa, 0xffffffff
+    },
+    {
+        0x80000000, 0xc0000000, 0x60000000, 0x90000000, 0xe8000000, 0x5c000000, 0x8e000000, 0xc5000000,
+        0x68800000, 0x9cc00000, 0xee600000, 0x55900000, 0x80680000, 0xc09c0000, 0x60ee0000, 0x90550000,
+        0xe8808000, 0x5cc0c000, 0x8e606000, 0xc5909000, 0x6868e800, 0x9c9c5c00, 0xeeee8e00, 0x5555c500,
+        0x8000e880, 0xc0005cc0, 0x60008e60, 0x9000c590, 0xe8006868, 0x5c009c9c, 0x8e00eeee, 0xc5005555
+    },
+    {
+        0x80000000, 0xc0000000, 0x20000000, 0x50000000, 0xf8000000, 0x74000000, 0xa2000000, 0x93000000,
+        0xd8800000, 0x25400000, 0x59e00000, 0xe6d00000, 0x78080000, 0xb40c0000, 0x82020000, 0xc3050000,
+        0x208f8000, 0x51474000, 0xfbea2000, 0x75d93000, 0xa0858800, 0x914e5400, 0xdbe79e00, 0x25db6d00,
+        0x58800080, 0xe54000c0, 0x79e00020, 0xb6d00050, 0x800800f8, 0xc00c0074, 0x200200a2, 0x50050093
+    }
+};
+
+
+rt_Sampler createSampler(uint pixelIndex, uint sampleIndex) {
+    rt_Sampler sampler = {pcgHash(pixelIndex), sampleIndex, 0};
+    return sampler;
+}
+
+
+uint hashCombine(uint seed, uint value) {
+    return seed ^ (pcgHash(value) + 0x9e3779b9u + (seed << 6) + (seed >> 2));
+}
+
+
+uint reverseBits(uint x) {
+    x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+    x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+    x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+    x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+    return (x >> 16) | (x << 16);
+}
+
+
+// Owen scrambling with a hash, every bit is flipped depending on the bits above it (Burley 2020)
+uint nestedUniformScramble(uint x, uint seed) {
+    x = reverseBits(x);
+    x += seed;
+    x ^= x * 0x6c50b47cu;
+    x ^= x * 0xb82f1e52u;
+    x ^= x * 0xc7afe638u;
+    x ^= x * 0x8d22f6e6u;
+    return reverseBits(x);
+}
+
+
+uint sobol(uint index, uint dimension) {
+    if (dimension == 0) {
+        return reverseBits(index);
+    }
+
+    uint x = 0;
+    for (uint bit = 0; index != 0; index >>= 1, bit++) {
+        if (index & 1) {
+            x ^= SOBOL_DIRECTIONS[dimension - 1][bit];
+        }
+    }
+    return x;
+}
+
+
+// in [0, 1)
+float sampleFloat(rt_Sampler* sampler) {
+    uint dimension = sampler->dimension++;
+#ifdef CONFIG__SAMPLER_RANDOM
+    uint bits = pcgHash(hashCombine(hashCombine(sampler->seed, sampler->sampleIndex), dimension));
+#else
+    // shuffling the sample order per group of dimensions keeps the groups from being correlated (padding)
+    uint groupSeed = hashCombine(sampler->seed, dimension / SOBOL_DIMENSIONS);
+    uint index = nestedUniformScramble(sampler->sampleIndex, groupSeed);
+    uint bits = nestedUniformScramble(sobol(index, dimension % SOBOL_DIMENSIONS), hashCombine(groupSeed, dimension % SOBOL_DIMENSIONS));
+#endif
+    return (bits >> 8) * (1.0f / 16777216.0f);
+}
+
+
+// in [0, 1)^2, both coordinates come from the same group of dimensions, so that the pair stays stratified in 2D
+// skips a dimension if the next one is the last of a group
+float2 sample2D(rt_Sampler* sampler) {
+    sampler->dimension += sampler->dimension % 2;
+    float u1 = sampleFloat(sampler);
+    float u2 = sampleFloat(sampler);
+    return (float2)(u1, u2);
+}
+
+
+#endif
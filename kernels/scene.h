@@ -0,0 +1,308 @@
+#ifndef SCENE_CL_H
+#define SCENE_CL_H
+
+#include "kernels/common.h"
+#include "kernels/objects.h"
+#include "kernels/bvh.h"
+
+
+typedef struct {
+    float3 backgroundColor;
+    uint sphereCount;
+    uint triangleCount;
+    uint bvhNodeCount;
+    // the sphere bvh starts at node 0
+    uint triangleBvhRoot;
+    uint instanceCount;
+    // top level bvh over the instances, their mesh bvh's are in the same buffer
+    uint instanceBvhRoot;
+    uint emitterCount;
+    // over the total emitted power, the area pdf of a point on an emitter is its emission's luminance times this
+    float emitterPdfScale;
+} rt_SceneParams;
+
+
+void traceSpheres(const rt_Ray* ray, const rt_SceneParams* scene, const rt_SceneGeometry* geometry, float3 invDirection, rt_HitRecord* record) {
+    // scenes converted without a bvh
+    if (scene->bvhNodeCount == 0) {
+        for (uint i = 0; i < scene->sphereCount; i++) {
+            const rt_Sphere sphere = geometry->spheres[i];
+            if (hitsSphere(&sphere, ray, record)) {
+                record->materialIndex = sphere.materialIndex;
+            }
+        }
+        return;
+    }
+
+    uint stack[BVH_STACK_SIZE];
+    uint stackSize = 0;
+    uint nodeIdx = 0;
+    if (hitsAabb(geometry->bvhNodes[nodeIdx].boundsMin, geometry->bvhNodes[nodeIdx].boundsMax, ray, invDirection, record->hitDistance) == FLT_MAX) {
+        return;
+    }
+
+    while (true) {
+        global const rt_BvhNode* node = &geometry->bvhNodes[nodeIdx];
+
+        if (node->count > 0) {
+            for (uint i = node->leftFirst; i < node->leftFirst + node->count; i++) {
+                const rt_Sphere sphere = geometry->spheres[i];
+                if (hitsSphere(&sphere, ray, record)) {
+                    record->materialIndex = sphere.materialIndex;
+                }
+            }
+            if (!popBvhStack(stack, &stackSize, &nodeIdx)) {
+                break;
+            }
+        } else if (!descendBvhNode(geometry->bvhNodes, node, ray, invDirection, record->hitDistance, stack, &stackSize, &nodeIdx)) {
+            break;
+        }
+    }
+}
+
+
+// walks the triangle bvh at `rootIdx`, used for the scene's own triangles and for the mesh of every instance
+void traceTriangleBvh(const rt_Ray* ray, const rt_SceneGeometry* geometry, uint rootIdx, float3 invDirection, rt_HitRecord* record) {
+    uint stack[BVH_STACK_SIZE];
+    uint stackSize = 0;
+    uint nodeIdx = rootIdx;
+    if (hitsAabb(geometry->bvhNodes[nodeIdx].boundsMin, geometry->bvhNodes[nodeIdx].boundsMax, ray, invDirection, record->hitDistance) == FLT_MAX) {
+        return;
+    }
+
+    while (true) {
+        global const rt_BvhNode* node = &geometry->bvhNodes[nodeIdx];
+
+        if (node->count > 0) {
+            for (uint i = node->leftFirst; i < node->leftFirst + node->count; i++) {
+                const rt_TriangleIndices triangle = geometry->triangles[i];
+                if (hitsIndexedTriangle(geometry, triangle, ray, record)) {
+                    record->materialIndex = triangle.materialIndex;
+                }
+            }
+            if (!popBvhStack(stack, &stackSize, &nodeIdx)) {
+                break;
+            }
+        } else if (!descendBvhNode(geometry->bvhNodes, node, ray, invDirection, record->hitDistance, stack, &stackSize, &nodeIdx)) {
+            break;
+        }
+    }
+}
+
+
+void traceTriangles(const rt_Ray* ray, const rt_SceneParams* scene, const rt_SceneGeometry* geometry, float3 invDirection, rt_HitRecord* record) {
+    if (scene->bvhNodeCount == 0) {
+        for (uint i = 0; i < scene->triangleCount; i++) {
+            const rt_TriangleIndices triangle = geometry->triangles[i];
+            if (hitsIndexedTriangle(geometry, triangle, ray, record)) {
+                record->materialIndex = triangle.materialIndex;
+            }
+        }
+        return;
+    }
+
+    traceTriangleBvh(ray, geometry, scene->triangleBvhRoot, invDirection, record);
+}
+
+
+// the ray is moved into the instance's object space, so the hit distances stay comparable with the world space ones
+bool hitsInstance(global const rt_Instance* instance, const rt_Ray* ray, const rt_SceneGeometry* geometry, rt_HitRecord* record) {
+    rt_Ray localRay;
+    localRay.origin = transformPoint(instance->worldToObject, ray->origin);
+    localRay.direction = transformDirection(instance->worldToObject, ray->direction);
+
+    float previousDistance = record->hitDistance;
+    traceTriangleBvh(&localRay, geometry, instance->bvhRoot, 1.0f / localRay.direction, record);
+    if (record->hitDistance >= previousDistance) {
+        return false;
+    }
+
+    // normals go back with the transpose of the world to object transform
+    float3 localNormal = record->worldNormal;
+    float3 normal = normalize(
+        localNormal.x * instance->worldToObject[0].xyz + localNormal.y * instance->worldToObject[1].xyz + localNormal.z * instance->worldToObject[2].xyz
+    );
+    record->worldNormal = dot(ray->direction, normal) > 0.0f ? -normal : normal;
+    float3 localGeometricNormal = record->geometricNormal;
+    float3 geometricNormal = normalize(
+        localGeometricNormal.x * instance->worldToObject[0].xyz + localGeometricNormal.y * instance->worldToObject[1].xyz + localGeometricNormal.z * instance->worldToObject[2].xyz
+    );
+    record->geometricNormal = dot(ray->direction, geometricNormal) > 0.0f ? -geometricNormal : geometricNormal;
+    record->worldPosition = ray->origin + ray->direction * record->hitDistance;
+    if (instance->materialIndex != INSTANCE_MESH_MATERIAL) {
+        record->materialIndex = instance->materialIndex;
+    }
+    return true;
+}
+
+
+void traceInstances(const rt_Ray* ray, const rt_SceneParams* scene, const rt_SceneGeometry* geometry, float3 invDirection, rt_HitRecord* record) {
+    uint stack[BVH_STACK_SIZE];
+    uint stackSize = 0;
+    uint nodeIdx = scene->instanceBvhRoot;
+    if (hitsAabb(geometry->bvhNodes[nodeIdx].boundsMin, geometry->bvhNodes[nodeIdx].boundsMax, ray, invDirection, record->hitDistance) == FLT_MAX) {
+        return;
+    }
+
+    while (true) {
+        global const rt_BvhNode* node = &geometry->bvhNodes[nodeIdx];
+
+        if (node->count > 0) {
+            for (uint i = node->leftFirst; i < node->leftFirst + node->count; i++) {
+                hitsInstance(&geometry->instances[i], ray, geometry, record);
+            }
+            if (!popBvhStack(stack, &stackSize, &nodeIdx)) {
+                break;
+            }
+        } else if (!descendBvhNode(geometry->bvhNodes, node, ray, invDirection, record->hitDistance, stack, &stackSize, &nodeIdx)) {
+            break;
+        }
+    }
+}
+
+
+// every primitive type is traced separately, the nearest hit so far culls the later ones
+rt_HitRecord traceRay(const rt_Ray* ray, const rt_SceneParams* scene, const rt_SceneGeometry* geometry) {
+    rt_HitRecord record;
+    record.hitDistance = FLT_MAX;
+
+    float3 invDirection = 1.0f / ray->direction;
+    if (scene->sphereCount > 0) {
+        traceSpheres(ray, scene, geometry, invDirection, &record);
+    }
+    if (scene->triangleCount > 0) {
+        traceTriangles(ray, scene, geometry, invDirection, &record);
+    }
+    if (scene->instanceCount > 0) {
+        traceInstances(ray, scene, geometry, invDirection, &record);
+    }
+
+    return record;
+}
+
+
+// Occlusion queries: the traversals mirror the closest hit ones, but stop at the first primitive hit
+// closer than `maxDistance` and compute no hit record
+
+
+bool occludedBySpheres(const rt_Ray* ray, const rt_SceneParams* scene, const rt_SceneGeometry* geometry, float3 invDirection, float maxDistance) {
+    if (scene->bvhNodeCount == 0) {
+        for (uint i = 0; i < scene->sphereCount; i++) {
+            const rt_Sphere sphere = geometry->spheres[i];
+            if (getSphereDistance(&sphere, ray) < maxDistance) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint stack[BVH_STACK_SIZE];
+    uint stackSize = 0;
+    uint nodeIdx = 0;
+    if (hitsAabb(geometry->bvhNodes[nodeIdx].boundsMin, geometry->bvhNodes[nodeIdx].boundsMax, ray, invDirection, maxDistance) == FLT_MAX) {
+        return false;
+    }
+
+    while (true) {
+        global const rt_BvhNode* node = &geometry->bvhNodes[nodeIdx];
+
+        if (node->count > 0) {
+            for (uint i = node->leftFirst; i < node->leftFirst + node->count; i++) {
+                const rt_Sphere sphere = geometry->spheres[i];
+                if (getSphereDistance(&sphere, ray) < maxDistance) {
+                    return true;
+                }
+            }
+            if (!popBvhStack(stack, &stackSize, &nodeIdx)) {
+                return false;
+            }
+        } else if (!descendBvhNode(geometry->bvhNodes, node, ray, invDirection, maxDistance, stack, &stackSize, &nodeIdx)) {
+            return false;
+        }
+    }
+}
+
+
+bool occludedByTriangleBvh(const rt_Ray* ray, const rt_SceneGeometry* geometry, uint rootIdx, float3 invDirection, float maxDistance) {
+    uint stack[BVH_STACK_SIZE];
+    uint stackSize = 0;
+    uint nodeIdx = rootIdx;
+    if (hitsAabb(geometry->bvhNodes[nodeIdx].boundsMin, geometry->bvhNodes[nodeIdx].boundsMax, ray, invDirection, maxDistance) == FLT_MAX) {
+        return false;
+    }
+
+    while (true) {
+        global const rt_BvhNode* node = &geometry->bvhNodes[nodeIdx];
+
+        if (node->count > 0) {
+            for (uint i = node->leftFirst; i < node->leftFirst + node->count; i++) {
+                if (getIndexedTriangleDistance(geometry, geometry->triangles[i], ray) < maxDistance) {
+                    return true;
+                }
+            }
+            if (!popBvhStack(stack, &stackSize, &nodeIdx)) {
+                return false;
+            }
+        } else if (!descendBvhNode(geometry->bvhNodes, node, ray, invDirection, maxDistance, stack, &stackSize, &nodeIdx)) {
+            return false;
+        }
+    }
+}
+
+
+bool occludedByTriangles(const rt_Ray* ray, const rt_SceneParams* scene, const rt_SceneGeometry* geometry, float3 invDirection, float maxDistance) {
+    if (scene->bvhNodeCount == 0) {
+        for (uint i = 0; i < scene->triangleCount; i++) {
+            if (getIndexedTriangleDistance(geometry, geometry->triangles[i], ray) < maxDistance) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    return occludedByTriangleBvh(ray, geometry, scene->triangleBvhRoot, invDirection, maxDistance);
+}
+
+
+// distances along the object space ray are the same as along the world space one (the transform is affine)
+bool occludedByInstances(const rt_Ray* ray, const rt_SceneParams* scene, const rt_SceneGeometry* geometry, float3 invDirection, float maxDistance) {
+    uint stack[BVH_STACK_SIZE];
+    uint stackSize = 0;
+    uint nodeIdx = scene->instanceBvhRoot;
+    if (hitsAabb(geometry->bvhNodes[nodeIdx].boundsMin, geometry->bvhNodes[nodeIdx].boundsMax, ray, invDirection, maxDistance) == FLT_MAX) {
+        return false;
+    }
+
+    while (true) {
+        global const rt_BvhNode* node = &geometry->bvhNodes[nodeIdx];
+
+        if (node->count > 0) {
+            for (uint i = node->leftFirst; i < node->leftFirst + node->count; i++) {
+                global const rt_Instance* instance = &geometry->instances[i];
+                rt_Ray localRay;
+                localRay.origin = transformPoint(instance->worldToObject, ray->origin);
+                localRay.direction = transformDirection(instance->worldToObject, ray->direction);
+                if (occludedByTriangleBvh(&localRay, geometry, instance->bvhRoot, 1.0f / localRay.direction, maxDistance)) {
+                    return true;
+                }
+            }
+            if (!popBvhStack(stack, &stackSize, &nodeIdx)) {
+                return false;
+            }
+        } else if (!descendBvhNode(geometry->bvhNodes, node, ray, invDirection, maxDistance, stack, &stackSize, &nodeIdx)) {
+            return false;
+        }
+    }
+}
+
+
+// whether anything is hit along `ray` before `maxDistance`
+bool occluded(const rt_Ray* ray, float maxDistance, const rt_SceneParams* scene, const rt_SceneGeometry* geometry) {
+    float3 invDirection = 1.0f / ray->direction;
+    return (scene->sphereCount > 0 && occludedBySpheres(ray, scene, geometry, invDirection, maxDistance))
+        || (scene->triangleCount > 0 && occludedByTriangles(ray, scene, geometry, invDirection, maxDistance))
+        || (scene->instanceCount > 0 && occludedByInstances(ray, scene, geometry, invDirection, maxDistance));
+}
+
+
+#endif
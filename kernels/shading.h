@@ -0,0 +1,94 @@
+
+#ifndef SHADING_CL_H
+#define SHADING_CL_H
+
+#include "kernels/common.h"
+#include "kernels/sampler.h"
+#include "kernels/scene.h"
+#include "kernels/bsdf.h"
+#include "kernels/lights.h"
+
+// even bright paths end now and then, so that no path runs to the bounce limit for sure
+#define ROULETTE_MAX_SURVIVAL 0.95f
+
+
+// Gathers the light at the hit (or the background on a miss), samples an emitter, and scatters `ray` off the surface
+// `bsdfPdf` is the pdf the previous hit had of sampling `ray` (zero for camera rays) and is set to the one of the new ray
+// shadow rays are added to `rayCount`, returns false if the path has ended
+bool shadeHit(
+    rt_Ray* ray, const rt_HitRecord* record, const rt_SceneParams* scene, const rt_SceneGeometry* geometry, global const rt_Material* materials,
+    float3* light, float3* contribution, float* bsdfPdf, rt_Sampler* sampler, uint* rayCount
+) {
+    if (record->hitDistance == FLT_MAX) {
+        *light += scene->backgroundColor * *contribution;
+        return false;
+    }
+
+    global const rt_Material* material = &materials[record->materialIndex];
+
+    // sphere normals point outwards, also when hit from the inside
+    float3 wo = -ray->direction;
+    float3 normal = dot(wo, record->worldNormal) < 0.0f ? -record->worldNormal : record->worldNormal;
+
+    // emitters hit by a bsdf ray were also reachable by the light sample of the previous hit
+    // its pdf is converted to solid angle with the geometric normal, like in `sampleDirectLight`
+    // (the inside of a sphere is never light sampled)
+    float emissionWeight = 1.0f;
+    float cosLight = dot(record->geometricNormal, wo);
+    if (*bsdfPdf > 0.0f && scene->emitterCount > 0 && cosLight > 0.0f) {
+        float lightPdf = getEmitterPdf(scene, material->emissionColor) * record->hitDistance * record->hitDistance / cosLight;
+        emissionWeight = powerHeuristic(*bsdfPdf, lightPdf);
+    }
+    *light += material->emissionColor * *contribution * emissionWeight;
+
+    if (scene->emitterCount > 0) {
+        *light += sampleDirectLight(record, normal, wo, material, scene, geometry, sampler, rayCount) * *contribution;
+    }
+
+    rt_BsdfSample sample;
+    if (!sampleBsdf(material, normal, wo, sampler, &sample)) {
+        return false;
+    }
+    *contribution *= sample.weight;
+    *bsdfPdf = sample.pdf;
+    ray->origin = record->worldPosition + normal * 0.001f;
+    ray->direction = sample.direction;
+    return true;
+}
+
+
+// Russian roulette: from `rouletteDepth` bounces on, paths go on with the probability of their throughput's largest
+// channel (at most ROULETTE_MAX_SURVIVAL) and the survivors are scaled up to stay unbiased, takes 1 dimension from there on
+// returns false if the path has ended
+bool survivesRoulette(float3* contribution, uint depth, uint rouletteDepth, rt_Sampler* sampler) {
+    if (depth < rouletteDepth) {
+        return true;
+    }
+
+    float survival = fmin(fmax(contribution->x, fmax(contribution->y, contribution->z)), ROULETTE_MAX_SURVIVAL);
+    if (sampleFloat(sampler) >= survival) {
+        return false;
+    }
+    *contribution /= survival;
+    return true;
+}
+
+
+// First hit features for the denoiser, the albedo is the background color on a miss (with a zero normal)
+// does nothing if the feature buffers are disabled (null)
+void writeAovs(global float4* albedoAovs, global float4* normalAovs, uint pixelIndex, const rt_HitRecord* record, const rt_SceneParams* scene, global const rt_Material* materials) {
+    if (albedoAovs == 0) {
+        return;
+    }
+
+    if (record->hitDistance == FLT_MAX) {
+        albedoAovs[pixelIndex] = (float4)(scene->backgroundColor, 1.0f);
+        normalAovs[pixelIndex] = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
+        return;
+    }
+    albedoAovs[pixelIndex] = (float4)(materials[record->materialIndex].color, 1.0f);
+    normalAovs[pixelIndex] = (float4)(record->worldNormal, 0.0f);
+}
+
+
+#endif
@@ -8,10 +8,12 @@
 typedef struct {
     float3 position;
     float radius;
+    uint materialIndex;
 } rt_Sphere;
 
 
-bool hitsSphere(const rt_Sphere* sphere, const rt_Ray* ray, rt_HitRecord* record) {
+// distance to the near intersection, FLT_MAX if the sphere is missed or behind the ray
+float getSphereDistance(const rt_Sphere* sphere, const rt_Ray* ray) {
     float3 oc = ray->origin - sphere->position;
     float a = dot(ray->direction, ray->direction);
     float b = 2.0f * dot(oc, ray->direction);
@@ -19,16 +21,21 @@ bool hitsSphere(const rt_Sphere* sphere, const rt_Ray* ray, rt_HitRecord* record
     float d = b*b - 4*a*c;
 
     if (d < 0.0f) {
-        return false;
+        return FLT_MAX;
     }
 
     float t = (-b - sqrt(d)) / (2.0f * a);
+    return t > 0.0f ? t : FLT_MAX;
+}
 
-    if (t > 0.0f && t < record->hitDistance) {
-        record->worldPosition = oc + ray->direction * t;
-        record->worldNormal = normalize(record->worldPosition);
+
+bool hitsSphere(const rt_Sphere* sphere, const rt_Ray* ray, rt_HitRecord* record) {
+    float t = getSphereDistance(sphere, ray);
+    if (t < record->hitDistance) {
+        record->worldPosition = ray->origin + ray->direction * t;
+        record->worldNormal = normalize(record->worldPosition - sphere->position);
+        record->geometricNormal = record->worldNormal;
         record->hitDistance = t;
-        record->worldPosition += sphere->position;
         return true;
     }
 
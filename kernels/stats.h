@@ -0,0 +1,19 @@
+
+#ifndef STATS_CL_H
+#define STATS_CL_H
+
+
+// `counter` is a 64 bit (low, high) pair of uints since 64 bit atomics are an extension
+// does nothing if counting is disabled (null buffer)
+void addToCounter(global uint* counter, uint value) {
+    if (counter == 0) {
+        return;
+    }
+    uint old = atomic_add(&counter[0], value);
+    if (old + value < old) {
+        atomic_inc(&counter[1]);
+    }
+}
+
+
+#endif
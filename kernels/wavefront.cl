@@ -0,0 +1,163 @@
+
+#include "kernels/common.h"
+#include "kernels/sampler.h"
+#include "kernels/scene.h"
+#include "kernels/shading.h"
+#include "kernels/ray_gen.h"
+#include "kernels/stats.h"
+#include "kernels/accumulation.h"
+
+// The queue kernels are launched over every pixel of the rendered region and the work-items past
+// the current queue size exit early, so the host never has to read the queue sizes back
+
+
+typedef struct {
+    rt_Ray ray;
+    float3 light;
+    float3 contribution;
+    uint pixelIndex;
+    // of the ray's direction, zero for camera rays
+    float bsdfPdf;
+    rt_Sampler sampler;
+    uint depth;
+    uint alive;
+} rt_PathState;
+
+
+kernel void generatePaths(
+    const rt_Camera camera,
+    global rt_PathState* paths,
+    global uint* queueSize,
+    uint sampleIndex
+) {
+    // launched over a region of the image with a 2D range
+    uint pixelIndex = get_global_id(1) * camera.imageSize.x + get_global_id(0);
+    uint pathIdx = (get_global_id(1) - get_global_offset(1)) * get_global_size(0) + (get_global_id(0) - get_global_offset(0));
+    if (pathIdx == 0) {
+        *queueSize = get_global_size(0) * get_global_size(1);
+    }
+
+    rt_PathState path;
+    path.ray = getRay(&camera, pixelIndex);
+    path.light = (float3)(0.0f, 0.0f, 0.0f);
+    path.contribution = (float3)(1.0f, 1.0f, 1.0f);
+    path.pixelIndex = pixelIndex;
+    path.bsdfPdf = 0.0f;
+    path.sampler = createSampler(pixelIndex, sampleIndex);
+    path.depth = 0;
+    path.alive = 1;
+    paths[pathIdx] = path;
+}
+
+
+kernel void extendPaths(
+    const rt_SceneParams scene,
+    global const rt_Sphere* spheres,
+    global const float3* vertices,
+    global const float3* normals,
+    global const rt_TriangleIndices* triangles,
+    global const rt_BvhNode* bvhNodes,
+    global const rt_Instance* instances,
+    global const rt_PathState* paths,
+    global const uint* queueSize,
+    global rt_HitRecord* hits,
+    global uint* nextQueueSize,
+    global uint* rayCounter
+) {
+    uint pathIdx = get_global_id(0);
+    if (pathIdx == 0) {
+        // nothing else touches the next queue during this kernel
+        *nextQueueSize = 0;
+        addToCounter(rayCounter, *queueSize);
+    }
+    if (pathIdx >= *queueSize) {
+        return;
+    }
+
+    rt_Ray ray = paths[pathIdx].ray;
+    const rt_SceneGeometry geometry = {spheres, vertices, normals, triangles, bvhNodes, instances, 0};
+    hits[pathIdx] = traceRay(&ray, &scene, &geometry);
+}
+
+
+// shadow rays for light sampling are traced here, from the shaded hits
+kernel void shadePaths(
+    const rt_SceneParams scene,
+    global const rt_Sphere* spheres,
+    global const float3* vertices,
+    global const float3* normals,
+    global const rt_TriangleIndices* triangles,
+    global const rt_BvhNode* bvhNodes,
+    global const rt_Instance* instances,
+    global const rt_Emitter* emitters,
+    global const rt_Material* materials,
+    global rt_PathState* paths,
+    global const uint* queueSize,
+    global const rt_HitRecord* hits,
+    global float4* radiance,
+    uint bounceLimit,
+    uint rouletteDepth,
+    global float4* albedoAovs,
+    global float4* normalAovs,
+    global uint* rayCounter
+) {
+    uint pathIdx = get_global_id(0);
+    if (pathIdx >= *queueSize) {
+        return;
+    }
+
+    rt_PathState path = paths[pathIdx];
+    rt_HitRecord record = hits[pathIdx];
+
+    if (path.depth == 0) {
+        writeAovs(albedoAovs, normalAovs, path.pixelIndex, &record, &scene, materials);
+    }
+    const rt_SceneGeometry geometry = {spheres, vertices, normals, triangles, bvhNodes, instances, emitters};
+    uint shadowRayCount = 0;
+    bool alive = shadeHit(&path.ray, &record, &scene, &geometry, materials, &path.light, &path.contribution, &path.bsdfPdf, &path.sampler, &shadowRayCount);
+    if (shadowRayCount > 0) {
+        addToCounter(rayCounter, shadowRayCount);
+    }
+    path.depth++;
+    path.alive = alive && path.depth < bounceLimit && survivesRoulette(&path.contribution, path.depth, rouletteDepth, &path.sampler);
+
+    // each pixel has a single path in flight, so no atomics are needed
+    if (!path.alive) {
+        radiance[path.pixelIndex] += (float4)(path.light, 0.0f);
+    }
+    paths[pathIdx] = path;
+}
+
+
+kernel void compactPaths(
+    global const rt_PathState* paths,
+    global const uint* queueSize,
+    global rt_PathState* nextPaths,
+    global uint* nextQueueSize
+) {
+    uint pathIdx = get_global_id(0);
+    if (pathIdx >= *queueSize || !paths[pathIdx].alive) {
+        return;
+    }
+
+    nextPaths[atomic_inc(nextQueueSize)] = paths[pathIdx];
+}
+
+
+kernel void writeRadiance(
+    global float4* radiance,
+    uint sampleCount,
+    uint imgWidth,
+    global const float4* prevMeans,
+    global float4* means,
+    uint frameCount,
+    write_only image2d_t out
+) {
+    // launched over a region of the image with a 2D range
+    int2 imgCoords = {get_global_id(0), get_global_id(1)};
+    uint pixelIndex = imgCoords.y * imgWidth + imgCoords.x;
+
+    float3 color = accumulateColor(prevMeans, means, pixelIndex, frameCount, radiance[pixelIndex].xyz / sampleCount);
+    write_imagef(out, imgCoords, (float4)(color, 1.0f));
+    radiance[pixelIndex] = (float4)(0.0f, 0.0f, 0.0f, 0.0f);
+}
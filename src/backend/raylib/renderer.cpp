@@ -29,7 +29,7 @@ rl::Texture createTexture(glm::ivec2 imageSize, Format format) {
 }
 
 
-Renderer::Renderer(const Raytracer& raytracer, glm::ivec2 windowSize, int targetFps, rl::Texture outTexture, bool clglInterop)
+Renderer::Renderer(Raytracer& raytracer, glm::ivec2 windowSize, int targetFps, rl::Texture outTexture, bool clglInterop)
 : m_raytracer(raytracer), m_windowSize(windowSize), m_outTexture(outTexture), m_clglInterop(clglInterop) {
     rl::SetTargetFPS(targetFps);
 
@@ -50,9 +50,22 @@ Renderer::~Renderer() {
 
 
 void Renderer::update() {
-    if (!m_clglInterop) {
+    if (m_clglInterop) {
+        return;
+    }
+
+    if (!m_asyncReadback) {
         m_raytracer.readPixels(m_outBuffer);
         rl::UpdateTexture(m_outTexture, m_outBuffer);
+        return;
+    }
+
+    m_raytracer.requestReadback();
+    uint64_t sequence;
+    const uint8_t* pixels = m_raytracer.getLatestPixels(&sequence);
+    if (pixels && sequence != m_uploadedSequence) {
+        rl::UpdateTexture(m_outTexture, pixels);
+        m_uploadedSequence = sequence;
     }
 }
 
@@ -16,17 +16,22 @@ rl::Texture createTexture(glm::ivec2 imageSize, Format format);
 class Renderer {
 
     public:
-        Renderer(const Raytracer& raytracer, glm::ivec2 windowSize, int targetFps, rl::Texture outTexture, bool clglInterop);
+        Renderer(Raytracer& raytracer, glm::ivec2 windowSize, int targetFps, rl::Texture outTexture, bool clglInterop);
         ~Renderer();
         void update();
         void draw();
+        // if enabled `update` uploads the latest finished readback instead of waiting for a new one
+        void setAsyncReadback(bool enable) { m_asyncReadback = enable; }
+        bool isAsyncReadback() const { return m_asyncReadback; }
 
     private:
-        const Raytracer& m_raytracer;
+        Raytracer& m_raytracer;
         glm::ivec2 m_windowSize;
         uint8_t* m_outBuffer;
         rl::Texture m_outTexture;
         bool m_clglInterop;
+        bool m_asyncReadback = false;
+        uint64_t m_uploadedSequence = 0;
 
 };
 
@@ -1,9 +1,13 @@
 
 #include "src/clutils.h"
+#include <algorithm>
+#include <cstdlib>
+#ifdef _WIN32
 // required for creating cl context
 #define  GLFW_EXPOSE_NATIVE_WGL
 #include <glfw/glfw3.h>
 #include <glfw/glfw3native.h>
+#endif
 
 
 namespace rt {
@@ -16,30 +20,154 @@ std::vector<cl::Platform> getAllClPlatforms() {
 
 
 std::vector<cl::Device> getAllClDevices(cl::Platform platform) {
+    return getAllClDevices(platform, CL_DEVICE_TYPE_GPU);
+}
+
+
+std::vector<cl::Device> getAllClDevices(cl::Platform platform, cl_device_type deviceType) {
     std::vector<cl::Device> res;
-    platform.getDevices(CL_DEVICE_TYPE_GPU, &res);
+    platform.getDevices(deviceType, &res);
     return res;
 }
 
 
-CL_Objects createClObjects(cl::Platform platform, cl::Device device) {
+static std::string toLower(std::string str) {
+    std::transform(str.begin(), str.end(), str.begin(), [](unsigned char c) { return std::tolower(c); });
+    return str;
+}
+
+
+DeviceSelector getDeviceSelectorFromEnv(DeviceSelector defaults) {
+    const char* env = std::getenv("RT_CL_DEVICE");
+    if (!env || env[0] == '\0') {
+        return defaults;
+    }
+
+    std::string value = toLower(env);
+    int platformIdx, deviceIdx;
+    if (value == "gpu") {
+        defaults.type = CL_DEVICE_TYPE_GPU;
+    } else if (value == "cpu") {
+        defaults.type = CL_DEVICE_TYPE_CPU;
+    } else if (value == "accelerator") {
+        defaults.type = CL_DEVICE_TYPE_ACCELERATOR;
+    } else if (value == "all") {
+        defaults.type = CL_DEVICE_TYPE_ALL;
+    } else if (sscanf(value.c_str(), "%d:%d", &platformIdx, &deviceIdx) == 2) {
+        defaults.platformIdx = platformIdx;
+        defaults.deviceIdx = deviceIdx;
+    } else {
+        defaults.name = env;
+    }
+    return defaults;
+}
+
+
+bool selectClDevice(const DeviceSelector& selector, cl::Platform& outPlatform, cl::Device& outDevice) {
+    std::vector<cl::Platform> platforms = getAllClPlatforms();
+    std::string name = toLower(selector.name);
+
+    bool found = false;
+    bool bestIsGpu = false;
+    cl_uint bestComputeUnits = 0;
+    for (int platformIdx = 0; platformIdx < platforms.size(); platformIdx++) {
+        if (selector.platformIdx != -1 && selector.platformIdx != platformIdx) {
+            continue;
+        }
+
+        std::vector<cl::Device> devices = getAllClDevices(platforms[platformIdx], selector.type);
+        for (int deviceIdx = 0; deviceIdx < devices.size(); deviceIdx++) {
+            if (selector.deviceIdx != -1 && selector.deviceIdx != deviceIdx) {
+                continue;
+            }
+
+            const cl::Device& device = devices[deviceIdx];
+            if (!name.empty() && toLower(device.getInfo<CL_DEVICE_NAME>()).find(name) == std::string::npos) {
+                continue;
+            }
+            cl_uint computeUnits = device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+            if (computeUnits < selector.minComputeUnits) {
+                continue;
+            }
+
+            bool isGpu = device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_GPU;
+            bool isBetter = !found || (isGpu && !bestIsGpu) || (isGpu == bestIsGpu && computeUnits > bestComputeUnits);
+            if (isBetter) {
+                found = true;
+                bestIsGpu = isGpu;
+                bestComputeUnits = computeUnits;
+                outPlatform = platforms[platformIdx];
+                outDevice = device;
+            }
+        }
+    }
+
+    if (!found) {
+        printf("ERROR (`selectClDevice`): No OpenCL device matches the selection\n");
+    }
+    return found;
+}
+
+
+std::string getClDeviceSummary(cl::Platform platform, cl::Device device) {
+    cl_device_type type = device.getInfo<CL_DEVICE_TYPE>();
+    const char* typeName = (type & CL_DEVICE_TYPE_GPU) ? "GPU" : (type & CL_DEVICE_TYPE_CPU) ? "CPU" : (type & CL_DEVICE_TYPE_ACCELERATOR) ? "Accelerator" : "Other";
+
+    char details[128];
+    snprintf(
+        details, sizeof(details), " [%s, %u CUs, %u MHz, %llu MB] on ",
+        typeName,
+        device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>(),
+        device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>(),
+        (unsigned long long) device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>() / (1024 * 1024)
+    );
+
+    // strings returned by the driver can include the null terminator
+    std::string deviceName = device.getInfo<CL_DEVICE_NAME>().c_str();
+    std::string platformName = platform.getInfo<CL_PLATFORM_NAME>().c_str();
+    std::string platformVersion = platform.getInfo<CL_PLATFORM_VERSION>().c_str();
+    return deviceName + details + platformName + " (" + platformVersion + ")";
+}
+
+
+CL_Objects createClObjects(cl::Platform platform, cl::Device device, bool enableProfiling) {
     CL_Objects res;
     res.platform = platform;
     res.device = device;
     res.context = cl::Context(device);
-    res.queue = cl::CommandQueue(res.context, res.device);
+    res.queue = cl::CommandQueue(res.context, res.device, enableProfiling ? CL_QUEUE_PROFILING_ENABLE : 0);
+    res.profilingEnabled = enableProfiling;
+    return res;
+}
+
+
+std::vector<CL_Objects> createClObjectsForAllDevices(cl_device_type deviceType) {
+    std::vector<CL_Objects> res;
+    for (const cl::Platform& platform : getAllClPlatforms()) {
+        for (const cl::Device& device : getAllClDevices(platform, deviceType)) {
+            res.push_back(createClObjects(platform, device));
+        }
+    }
     return res;
 }
 
 
 bool supports_clGlInterop(cl::Device device) {
+#ifndef _WIN32
+    return false;
+#else
     std::string allExtensions = device.getInfo<CL_DEVICE_EXTENSIONS>();
     const char* ext = "cl_khr_gl_sharing";
     return allExtensions.find(ext) != std::string::npos;
+#endif
 }
 
 
-CL_Objects createClObjects_withInterop(cl::Platform platform, cl::Device device) {
+CL_Objects createClObjects_withInterop(cl::Platform platform, cl::Device device, bool enableProfiling) {
+#ifndef _WIN32
+    printf("WARN (`createClObjects_withInterop`): cl-gl interop is only supported on windows, creating a normal context\n");
+    return createClObjects(platform, device, enableProfiling);
+#else
     cl_context_properties props[] = {
         CL_GL_CONTEXT_KHR, (cl_context_properties) wglGetCurrentContext(),
         CL_WGL_HDC_KHR, (cl_context_properties) wglGetCurrentDC(),
@@ -51,8 +179,10 @@ CL_Objects createClObjects_withInterop(cl::Platform platform, cl::Device device)
     res.platform = platform;
     res.device = device;
     res.context = cl::Context(device, props);
-    res.queue = cl::CommandQueue(res.context, res.device);
+    res.queue = cl::CommandQueue(res.context, res.device, enableProfiling ? CL_QUEUE_PROFILING_ENABLE : 0);
+    res.profilingEnabled = enableProfiling;
     return res;
+#endif
 }
 
 }
@@ -2,6 +2,7 @@
 #pragma once
 
 #include <CL/opencl.hpp>
+#include <string>
 
 
 namespace rt {
@@ -11,6 +12,8 @@ struct CL_Objects {
     cl::Device device;
     cl::Context context;
     cl::CommandQueue queue;
+    // whether the queue records timestamps of its commands (CL_QUEUE_PROFILING_ENABLE)
+    bool profilingEnabled = false;
 };
 
 
@@ -19,17 +22,51 @@ std::vector<cl::Platform> getAllClPlatforms();
 // Only the GPU(s)
 std::vector<cl::Device> getAllClDevices(cl::Platform platform);
 
+// Devices of the given type(s), eg CL_DEVICE_TYPE_CPU
+std::vector<cl::Device> getAllClDevices(cl::Platform platform, cl_device_type deviceType);
+
+
+// Criteria for picking a device out of every platform
+// `platformIdx`/`deviceIdx` (if not -1) pin an exact device, indices are into getAllClPlatforms / getAllClDevices(.., type)
+struct DeviceSelector {
+    cl_device_type type = CL_DEVICE_TYPE_ALL;
+    // case insensitive substring of the device name, empty matches everything
+    std::string name;
+    cl_uint minComputeUnits = 0;
+    int platformIdx = -1;
+    int deviceIdx = -1;
+};
+
+
+// Overrides fields of `defaults` from the RT_CL_DEVICE env variable if it is set, accepted values:
+//   gpu | cpu | accelerator | all, `<platformIdx>:<deviceIdx>`, or anything else as a name substring
+DeviceSelector getDeviceSelectorFromEnv(DeviceSelector defaults = {});
+
+
+// Picks the best device matching `selector`: GPUs over other types, then the most compute units
+// returns false if nothing matches
+bool selectClDevice(const DeviceSelector& selector, cl::Platform& outPlatform, cl::Device& outDevice);
+
+
+// One line description, eg "NVIDIA GeForce RTX 3060 [GPU, 28 CUs, 1777 MHz, 12288 MB] on NVIDIA CUDA (OpenCL 3.0 CUDA)"
+std::string getClDeviceSummary(cl::Platform platform, cl::Device device);
+
 
 // creates context normally
-CL_Objects createClObjects(cl::Platform platform, cl::Device device);
+CL_Objects createClObjects(cl::Platform platform, cl::Device device, bool enableProfiling = false);
+
+
+// contexts (one each) for every device of the given type(s) across all platforms
+std::vector<CL_Objects> createClObjectsForAllDevices(cl_device_type deviceType = CL_DEVICE_TYPE_ALL);
 
 
 // checks for cl-gl interop (memory sharing)
+// Note: interop is only implemented for windows (wgl), always false elsewhere
 bool supports_clGlInterop(cl::Device device);
 
 
 // creates the context with cl-gl interop enabled
 // Note: Opengl should be initialized
-CL_Objects createClObjects_withInterop(cl::Platform platform, cl::Device device);
+CL_Objects createClObjects_withInterop(cl::Platform platform, cl::Device device, bool enableProfiling = false);
 
 }
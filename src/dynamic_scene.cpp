@@ -0,0 +1,413 @@
+#include "src/dynamic_scene.h"
+#include <algorithm>
+
+// smallest buffer (in elements) allocated for an array
+#define RT_DYNAMIC_SCENE_MIN_CAPACITY 64
+// dirty elements at most this far apart are uploaded with a single write
+#define RT_DYNAMIC_SCENE_MERGE_GAP 16
+// the whole bvh is refit bottom up (instead of each moved leaf up to the root) if more than 1/N of its nodes are moved leaves
+#define RT_BVH_FULL_REFIT_FRACTION 16
+// the bvh is rebuilt once refitting makes its sah cost this many times higher than after the build
+#define RT_BVH_REBUILD_COST_RATIO 1.5f
+
+
+namespace rt {
+
+static const uint32_t NO_NODE = UINT32_MAX;
+
+
+void DynamicScene::DeviceArray::markDirty(uint32_t first, uint32_t count) {
+    for (uint32_t i = 0; i < count; i++) {
+        dirty.push_back(first + i);
+    }
+}
+
+
+DynamicScene::DynamicScene(cl::Context clContext, cl::CommandQueue clQueue, bool buildBvh) {
+    m_clContext = clContext;
+    m_clQueue = clQueue;
+    m_buildBvh = buildBvh;
+    m_scene.extra = getSceneExtra(m_data);
+}
+
+
+void DynamicScene::setScene(const Scene& scene) {
+    waitForUploads();
+
+    // triangles get their own vertices so that moving one doesn't move its neighbours
+    m_data = buildSceneData(scene, m_buildBvh, true);
+    m_rebuildBvh = false;
+    m_rebuildEmitters = false;
+    m_dirtyLeaves.clear();
+
+    m_objectIsSphere.resize(scene.objects.size());
+    for (int objIdx = 0; objIdx < scene.objects.size(); objIdx++) {
+        m_objectIsSphere[objIdx] = std::holds_alternative<internal::Sphere>(scene.objects[objIdx].internal);
+    }
+
+    findBvhParents();
+    m_bvhBuildCost = getBvhCost();
+    m_bvhCostRatio = 1.0f;
+
+    for (DeviceArray* array : {&m_spheres, &m_vertices, &m_normals, &m_triangles, &m_materials, &m_bvhNodes, &m_instances, &m_emitters}) {
+        array->dirty.clear();
+        array->allDirty = true;
+    }
+}
+
+
+bool DynamicScene::setObject(uint32_t objIdx, const Object& object) {
+    if (objIdx >= m_objectIsSphere.size()) {
+        printf("ERROR (`rt::DynamicScene::setObject`): Object index %u is out of range (%d objects)\n", objIdx, (int) m_objectIsSphere.size());
+        return false;
+    }
+    bool isSphere = std::holds_alternative<internal::Sphere>(object.internal);
+    if (isSphere != m_objectIsSphere[objIdx]) {
+        printf("ERROR (`rt::DynamicScene::setObject`): Object %u can't change its type\n", objIdx);
+        return false;
+    }
+
+    waitForUploads();
+    uint32_t materialIndex = getMaterialIndex(object.material);
+    uint32_t slot = m_data.objectSlots[objIdx];
+    // a pending rebuild replaces the tree anyway (and the leaves don't know the new primitives yet)
+    bool refit = !m_rebuildBvh && !m_bvhParents.empty();
+
+    // objects that neither were nor become emissive aren't in the emitter list
+    uint32_t oldMaterialIndex = isSphere ? m_data.spheres[slot].materialIndex : m_data.triangles[slot].materialIndex;
+    if (isEmissive(m_data.materials[oldMaterialIndex]) || isEmissive(m_data.materials[materialIndex])) {
+        m_rebuildEmitters = true;
+    }
+
+    if (isSphere) {
+        internal::Sphere sphere = std::get<internal::Sphere>(object.internal);
+        sphere.materialIndex = materialIndex;
+        m_data.spheres[slot] = sphere;
+        m_spheres.markDirty(slot);
+        if (refit) {
+            m_dirtyLeaves.push_back(m_sphereLeaves[slot]);
+        }
+    } else {
+        const internal::Triangle& triangle = std::get<internal::Triangle>(object.internal);
+        internal::TriangleIndices& indices = m_data.triangles[slot];
+        m_data.vertices[indices.v0] = triangle.v0;
+        m_data.vertices[indices.v1] = triangle.v1;
+        m_data.vertices[indices.v2] = triangle.v2;
+        m_vertices.markDirty(indices.v0);
+        m_vertices.markDirty(indices.v1);
+        m_vertices.markDirty(indices.v2);
+        if (indices.materialIndex != materialIndex) {
+            indices.materialIndex = materialIndex;
+            m_triangles.markDirty(slot);
+        }
+        if (refit) {
+            m_dirtyLeaves.push_back(m_triangleLeaves[slot]);
+        }
+    }
+    return true;
+}
+
+
+uint32_t DynamicScene::addObject(const Object& object) {
+    waitForUploads();
+    uint32_t materialIndex = getMaterialIndex(object.material);
+    uint32_t objIdx = m_objectIsSphere.size();
+
+    if (auto sphere = std::get_if<internal::Sphere>(&object.internal)) {
+        m_data.objectSlots.push_back(m_data.spheres.size());
+        m_spheres.markDirty(m_data.spheres.size());
+        m_data.spheres.push_back(*sphere);
+        m_data.spheres.back().materialIndex = materialIndex;
+        m_objectIsSphere.push_back(true);
+    } else if (auto triangle = std::get_if<internal::Triangle>(&object.internal)) {
+        uint32_t firstVertex = m_data.vertices.size();
+        m_data.vertices.push_back(triangle->v0);
+        m_data.vertices.push_back(triangle->v1);
+        m_data.vertices.push_back(triangle->v2);
+        m_vertices.markDirty(firstVertex, 3);
+        if (!m_data.normals.empty()) {
+            m_data.normals.resize(m_data.vertices.size(), {0.0f, 0.0f, 0.0f, 0.0f});
+            m_normals.markDirty(firstVertex, 3);
+        }
+
+        // scene triangles come before the ones of instanced meshes, which move up by one
+        uint32_t slot = m_data.numSceneTriangles++;
+        m_data.objectSlots.push_back(slot);
+        m_data.triangles.insert(m_data.triangles.begin() + slot, {firstVertex, firstVertex + 1, firstVertex + 2, materialIndex});
+        if (m_data.instancedMeshes.empty()) {
+            m_triangles.markDirty(slot);
+        } else {
+            for (InstancedMesh& mesh : m_data.instancedMeshes) {
+                mesh.firstTriangle++;
+            }
+            m_triangles.allDirty = true;
+        }
+        m_objectIsSphere.push_back(false);
+    }
+
+    m_rebuildBvh = hasBvh();
+    if (isEmissive(m_data.materials[materialIndex])) {
+        m_rebuildEmitters = true;
+    }
+    return objIdx;
+}
+
+
+bool DynamicScene::updateMaterial(const std::shared_ptr<internal::Material>& material) {
+    auto it = m_data.materialIndices.find(material);
+    if (it == m_data.materialIndices.end()) {
+        printf("ERROR (`rt::DynamicScene::updateMaterial`): Material is not used by the scene\n");
+        return false;
+    }
+
+    waitForUploads();
+    if (isEmissive(m_data.materials[it->second]) || isEmissive(*material)) {
+        m_rebuildEmitters = true;
+    }
+    m_data.materials[it->second] = *material;
+    m_materials.markDirty(it->second);
+    return true;
+}
+
+
+void DynamicScene::setBackgroundColor(const glm::vec3& color) {
+    // part of the kernel arguments, nothing to upload
+    m_data.backgroundColor = color;
+}
+
+
+void DynamicScene::update() {
+    waitForUploads();
+    if (!m_rebuildBvh && !m_dirtyLeaves.empty()) {
+        refitBvh();
+        m_bvhCostRatio = m_bvhBuildCost > 0.0f ? getBvhCost() / m_bvhBuildCost : 1.0f;
+        if (m_bvhCostRatio > RT_BVH_REBUILD_COST_RATIO) {
+            m_rebuildBvh = true;
+            m_bvhRebuildCount++;
+        }
+    }
+    if (m_rebuildBvh) {
+        rebuildBvh();
+        m_rebuildBvh = false;
+    }
+    if (m_rebuildEmitters) {
+        // the emitters are copies in world space, rewritten as a whole
+        buildEmitters(m_data);
+        m_emitters.allDirty = true;
+        m_rebuildEmitters = false;
+    }
+
+    m_lastUploadSize = 0;
+    uploadArray(m_spheres, m_data.spheres);
+    uploadArray(m_vertices, m_data.vertices);
+    uploadArray(m_normals, m_data.normals);
+    uploadArray(m_triangles, m_data.triangles);
+    uploadArray(m_materials, m_data.materials);
+    uploadArray(m_bvhNodes, m_data.bvhNodes);
+    uploadArray(m_instances, m_data.instances);
+    uploadArray(m_emitters, m_data.emitters);
+
+    // arrays that are empty keep their (unused) buffer, the counts tell the kernel not to read them
+    m_scene.spheresBuffer = m_spheres.buffer;
+    m_scene.verticesBuffer = m_vertices.buffer;
+    m_scene.normalsBuffer = m_data.normals.empty() ? cl::Buffer() : m_normals.buffer;
+    m_scene.trianglesBuffer = m_triangles.buffer;
+    m_scene.materialsBuffer = m_materials.buffer;
+    m_scene.bvhNodesBuffer = m_bvhNodes.buffer;
+    m_scene.instancesBuffer = m_instances.buffer;
+    m_scene.emittersBuffer = m_emitters.buffer;
+    m_scene.extra = getSceneExtra(m_data);
+}
+
+
+template <typename T>
+void DynamicScene::uploadArray(DeviceArray& array, const std::vector<T>& data) {
+    if (data.size() > array.capacity) {
+        size_t capacity = std::max({data.size(), array.capacity * 2, (size_t) RT_DYNAMIC_SCENE_MIN_CAPACITY});
+        int err = 0;
+        cl::Buffer buffer = cl::Buffer(m_clContext, CL_MEM_READ_ONLY, capacity * sizeof(T), nullptr, &err);
+        if (err) {
+            printf("ERROR (`rt::DynamicScene::update`): Unable to allocate a buffer of %.3f KB [Error code: %d]\n", (float) (capacity * sizeof(T)) / 1024, err);
+            return;
+        }
+        array.buffer = buffer;
+        array.capacity = capacity;
+        array.allDirty = true;
+    }
+
+    auto write = [&](size_t first, size_t count) {
+        cl::Event event;
+        m_clQueue.enqueueWriteBuffer(array.buffer, false, first * sizeof(T), count * sizeof(T), data.data() + first, nullptr, &event);
+        m_pendingUploads.push_back(event);
+        m_lastUploadSize += count * sizeof(T);
+    };
+
+    if (data.empty()) {
+        // nothing to write
+    } else if (array.allDirty) {
+        write(0, data.size());
+    } else if (!array.dirty.empty()) {
+        std::sort(array.dirty.begin(), array.dirty.end());
+        array.dirty.erase(std::unique(array.dirty.begin(), array.dirty.end()), array.dirty.end());
+
+        uint32_t first = array.dirty[0];
+        uint32_t last = array.dirty[0];
+        for (uint32_t index : array.dirty) {
+            if (index - last > RT_DYNAMIC_SCENE_MERGE_GAP) {
+                write(first, last - first + 1);
+                first = index;
+            }
+            last = index;
+        }
+        write(first, last - first + 1);
+    }
+
+    array.dirty.clear();
+    array.allDirty = false;
+}
+
+
+uint32_t DynamicScene::getMaterialIndex(const std::shared_ptr<internal::Material>& material) {
+    auto [it, inserted] = m_data.materialIndices.try_emplace(material, (uint32_t) m_data.materials.size());
+    if (inserted) {
+        m_materials.markDirty(m_data.materials.size());
+        m_data.materials.push_back(*material);
+    }
+    return it->second;
+}
+
+
+void DynamicScene::waitForUploads() {
+    // the writes read from the host arrays until they complete
+    if (!m_pendingUploads.empty()) {
+        cl::WaitForEvents(m_pendingUploads);
+        m_pendingUploads.clear();
+    }
+}
+
+
+void DynamicScene::rebuildBvh() {
+    std::vector<uint32_t> sphereSlots, triangleSlots;
+    buildSceneBvh(m_data, sphereSlots, triangleSlots);
+    for (int objIdx = 0; objIdx < m_objectIsSphere.size(); objIdx++) {
+        m_data.objectSlots[objIdx] = (m_objectIsSphere[objIdx] ? sphereSlots : triangleSlots)[m_data.objectSlots[objIdx]];
+    }
+    findBvhParents();
+    m_dirtyLeaves.clear();
+    m_bvhBuildCost = getBvhCost();
+    m_bvhCostRatio = 1.0f;
+
+    // the vertices (and normals) don't move, only the primitives referencing them
+    m_spheres.allDirty = true;
+    m_triangles.allDirty = true;
+    m_bvhNodes.allDirty = true;
+    m_instances.allDirty = true;
+}
+
+
+void DynamicScene::findBvhParents() {
+    const std::vector<internal::BvhNode>& nodes = m_data.bvhNodes;
+    m_bvhParents.assign(nodes.size(), NO_NODE);
+    m_sphereLeaves.assign(m_data.spheres.size(), NO_NODE);
+    m_triangleLeaves.assign(m_data.triangles.size(), NO_NODE);
+
+    // the bvh's of instanced meshes never move
+    for (uint32_t nodeIdx = 0; nodeIdx < m_data.firstInstanceNode; nodeIdx++) {
+        const internal::BvhNode& node = nodes[nodeIdx];
+        if (node.count == 0) {
+            m_bvhParents[node.leftFirst] = nodeIdx;
+            m_bvhParents[node.leftFirst + 1] = nodeIdx;
+            continue;
+        }
+
+        // the sphere bvh comes first
+        std::vector<uint32_t>& leaves = nodeIdx < m_data.triangleBvhRoot ? m_sphereLeaves : m_triangleLeaves;
+        for (uint32_t i = 0; i < node.count; i++) {
+            leaves[node.leftFirst + i] = nodeIdx;
+        }
+    }
+}
+
+
+static void setNodeBounds(internal::BvhNode& node, const Aabb& bounds) {
+    node.boundsMin = {bounds.min.x, bounds.min.y, bounds.min.z, 0.0f};
+    node.boundsMax = {bounds.max.x, bounds.max.y, bounds.max.z, 0.0f};
+}
+
+
+static Aabb getNodeBounds(const internal::BvhNode& node) {
+    return {toVec3(node.boundsMin), toVec3(node.boundsMax)};
+}
+
+
+void DynamicScene::refitBvh() {
+    std::sort(m_dirtyLeaves.begin(), m_dirtyLeaves.end());
+    m_dirtyLeaves.erase(std::unique(m_dirtyLeaves.begin(), m_dirtyLeaves.end()), m_dirtyLeaves.end());
+
+    if (m_dirtyLeaves.size() > m_data.firstInstanceNode / RT_BVH_FULL_REFIT_FRACTION) {
+        // children are always stored after their parent, so a reverse pass sees them first
+        for (uint32_t nodeIdx = m_data.firstInstanceNode; nodeIdx-- > 0;) {
+            refitBvhNode(nodeIdx);
+        }
+        m_bvhNodes.allDirty = true;
+    } else {
+        for (uint32_t leafIdx : m_dirtyLeaves) {
+            refitBvhPath(leafIdx);
+        }
+    }
+    m_dirtyLeaves.clear();
+}
+
+
+// recomputes the bounds of the leaf, then of its ancestors until one of them doesn't change
+void DynamicScene::refitBvhPath(uint32_t leafIdx) {
+    refitBvhNode(leafIdx);
+    m_bvhNodes.markDirty(leafIdx);
+
+    for (uint32_t nodeIdx = m_bvhParents[leafIdx]; nodeIdx != NO_NODE; nodeIdx = m_bvhParents[nodeIdx]) {
+        Aabb oldBounds = getNodeBounds(m_data.bvhNodes[nodeIdx]);
+        refitBvhNode(nodeIdx);
+        Aabb bounds = getNodeBounds(m_data.bvhNodes[nodeIdx]);
+        if (bounds.min == oldBounds.min && bounds.max == oldBounds.max) {
+            break;
+        }
+        m_bvhNodes.markDirty(nodeIdx);
+    }
+}
+
+
+// bounds of a leaf from its primitives, of an interior node from its children
+void DynamicScene::refitBvhNode(uint32_t nodeIdx) {
+    std::vector<internal::BvhNode>& nodes = m_data.bvhNodes;
+    internal::BvhNode& node = nodes[nodeIdx];
+
+    Aabb bounds;
+    if (node.count == 0) {
+        bounds = getNodeBounds(nodes[node.leftFirst]);
+        bounds.grow(getNodeBounds(nodes[node.leftFirst + 1]));
+    } else {
+        bool isSphere = nodeIdx < m_data.triangleBvhRoot;
+        for (uint32_t i = 0; i < node.count; i++) {
+            bounds.grow(getPrimitiveBounds(isSphere, node.leftFirst + i));
+        }
+    }
+    setNodeBounds(node, bounds);
+}
+
+
+float DynamicScene::getBvhCost() const {
+    // the sphere bvh is empty (and node 0 the triangle root) if there are no spheres, same for the triangles
+    float sphereCost = m_data.triangleBvhRoot > 0 ? rt::getBvhCost(m_data.bvhNodes, 0) : 0.0f;
+    float triangleCost = m_data.triangleBvhRoot < m_data.firstInstanceNode ? rt::getBvhCost(m_data.bvhNodes, m_data.triangleBvhRoot) : 0.0f;
+    return sphereCost + triangleCost;
+}
+
+
+Aabb DynamicScene::getPrimitiveBounds(bool isSphere, uint32_t slot) const {
+    if (isSphere) {
+        return getBounds(m_data.spheres[slot]);
+    }
+    return getBounds(m_data.triangles[slot], m_data.vertices);
+}
+
+}
@@ -0,0 +1,108 @@
+
+#pragma once
+
+#include "src/raytracer/scene.h"
+#include <vector>
+
+
+namespace rt {
+
+// A converted scene that can be edited after it is uploaded
+// edits only change the host copy, `update` then uploads the changed elements of each buffer
+// buffers grow geometrically, so adding objects only reallocates them once in a while
+// moving objects refits the bvh, it is rebuilt once the refit tree gets too slow to trace (see `RT_BVH_REBUILD_COST_RATIO`)
+// mesh instances are uploaded as given by `setScene`, only the scene objects can be edited
+// the emitter list is gathered again on the first `update` after an edit of an emissive object or material
+class DynamicScene {
+
+    public:
+        DynamicScene(cl::Context clContext, cl::CommandQueue clQueue, bool buildBvh = true);
+        // full conversion, the existing buffers are reused if they are large enough
+        void setScene(const Scene& scene);
+
+        // replaces the object at `objIdx` (in the order of `Scene::objects`), it must be of the same type
+        // with a bvh the nodes above it are refit on the next `update`, the tree itself does not change
+        bool setObject(uint32_t objIdx, const Object& object);
+        // appends an object, with a bvh the tree is rebuilt on the next `update`
+        uint32_t addObject(const Object& object);
+        // copies the current value of a material used by the scene
+        bool updateMaterial(const std::shared_ptr<internal::Material>& material);
+        void setBackgroundColor(const glm::vec3& color);
+        // builds a new bvh over the current primitives on the next `update`
+        void requestBvhRebuild() { m_rebuildBvh = hasBvh(); }
+
+        // uploads the changes since the last update with non blocking writes
+        void update();
+        // valid after `update`, until the next one
+        const internal::Scene& getScene() const { return m_scene; }
+        const SceneData& getData() const { return m_data; }
+        // bytes written by the last `update`
+        size_t getLastUploadSize() const { return m_lastUploadSize; }
+        // sah cost of the current bvh relative to its cost when it was built
+        float getBvhCostRatio() const { return m_bvhCostRatio; }
+        // rebuilds done by `update` (the first build of `setScene` not included)
+        uint32_t getBvhRebuildCount() const { return m_bvhRebuildCount; }
+
+    private:
+        // a host array and the device buffer it is mirrored to
+        struct DeviceArray {
+            cl::Buffer buffer;
+            // in elements
+            size_t capacity = 0;
+            // elements to upload, everything if `allDirty`
+            std::vector<uint32_t> dirty;
+            bool allDirty = true;
+
+            void markDirty(uint32_t first, uint32_t count = 1);
+        };
+
+        template <typename T>
+        void uploadArray(DeviceArray& array, const std::vector<T>& data);
+        // instances are always traced through a bvh
+        bool hasBvh() const { return m_buildBvh || !m_data.instances.empty(); }
+        uint32_t getMaterialIndex(const std::shared_ptr<internal::Material>& material);
+        void waitForUploads();
+
+        void rebuildBvh();
+        void findBvhParents();
+        void refitBvh();
+        void refitBvhPath(uint32_t leafIdx);
+        void refitBvhNode(uint32_t nodeIdx);
+        float getBvhCost() const;
+        Aabb getPrimitiveBounds(bool isSphere, uint32_t slot) const;
+
+    private:
+        cl::Context m_clContext;
+        cl::CommandQueue m_clQueue;
+        bool m_buildBvh;
+        bool m_rebuildBvh = false;
+        bool m_rebuildEmitters = false;
+
+        SceneData m_data;
+        internal::Scene m_scene;
+        std::vector<bool> m_objectIsSphere;
+
+        // parent of every bvh node, and the leaf of every sphere/triangle slot
+        std::vector<uint32_t> m_bvhParents;
+        std::vector<uint32_t> m_sphereLeaves;
+        std::vector<uint32_t> m_triangleLeaves;
+        // leaves whose primitives moved since the last update
+        std::vector<uint32_t> m_dirtyLeaves;
+        float m_bvhBuildCost = 0.0f;
+        float m_bvhCostRatio = 1.0f;
+        uint32_t m_bvhRebuildCount = 0;
+
+        DeviceArray m_spheres;
+        DeviceArray m_vertices;
+        DeviceArray m_normals;
+        DeviceArray m_triangles;
+        DeviceArray m_materials;
+        DeviceArray m_bvhNodes;
+        DeviceArray m_instances;
+        DeviceArray m_emitters;
+        std::vector<cl::Event> m_pendingUploads;
+        size_t m_lastUploadSize = 0;
+
+};
+
+}
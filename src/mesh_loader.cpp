@@ -0,0 +1,735 @@
+
+#include "src/mesh_loader.h"
+#include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+namespace rt {
+
+// Read only view of a whole file, unmapped on destruction
+class MappedFile {
+
+    public:
+        MappedFile(const char* filepath);
+        ~MappedFile();
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        bool isOpen() const { return m_data != nullptr; }
+        const char* begin() const { return m_data; }
+        const char* end() const { return m_data + m_size; }
+        size_t size() const { return m_size; }
+
+    private:
+        const char* m_data = nullptr;
+        size_t m_size = 0;
+#ifdef _WIN32
+        HANDLE m_file = INVALID_HANDLE_VALUE;
+        HANDLE m_mapping = nullptr;
+#endif
+
+};
+
+
+#ifdef _WIN32
+
+MappedFile::MappedFile(const char* filepath) {
+    m_file = CreateFileA(filepath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    LARGE_INTEGER fileSize;
+    if (m_file == INVALID_HANDLE_VALUE || !GetFileSizeEx(m_file, &fileSize) || fileSize.QuadPart == 0) {
+        return;
+    }
+
+    m_mapping = CreateFileMappingA(m_file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_mapping == nullptr) {
+        return;
+    }
+    m_data = (const char*) MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0);
+    m_size = m_data ? fileSize.QuadPart : 0;
+}
+
+
+MappedFile::~MappedFile() {
+    if (m_data) {
+        UnmapViewOfFile(m_data);
+    }
+    if (m_mapping) {
+        CloseHandle(m_mapping);
+    }
+    if (m_file != INVALID_HANDLE_VALUE) {
+        CloseHandle(m_file);
+    }
+}
+
+#else
+
+MappedFile::MappedFile(const char* filepath) {
+    int fd = open(filepath, O_RDONLY);
+    if (fd == -1) {
+        return;
+    }
+
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) == 0 && fileStat.st_size > 0) {
+        void* data = mmap(nullptr, fileStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            m_data = (const char*) data;
+            m_size = fileStat.st_size;
+        }
+    }
+    // the mapping stays valid after closing
+    close(fd);
+}
+
+
+MappedFile::~MappedFile() {
+    if (m_data) {
+        munmap((void*) m_data, m_size);
+    }
+}
+
+#endif
+
+
+static int getThreadCount(int numThreads) {
+    if (numThreads > 0) {
+        return numThreads;
+    }
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+
+// calls `func(chunkIdx)` for every chunk, each on its own thread (the first one on the calling thread)
+template <typename Func>
+static void runChunks(int numChunks, const Func& func) {
+    std::vector<std::thread> threads;
+    for (int chunkIdx = 1; chunkIdx < numChunks; chunkIdx++) {
+        threads.emplace_back(func, chunkIdx);
+    }
+    func(0);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+
+static bool hasExtension(const std::string& filepath, const char* extension) {
+    std::string lowerFilepath = filepath;
+    std::transform(lowerFilepath.begin(), lowerFilepath.end(), lowerFilepath.begin(), [](unsigned char c) { return std::tolower(c); });
+    size_t extensionLength = strlen(extension);
+    return lowerFilepath.size() >= extensionLength && lowerFilepath.compare(lowerFilepath.size() - extensionLength, extensionLength, extension) == 0;
+}
+
+
+bool loadMesh(const char* filepath, std::shared_ptr<internal::Material> material, Mesh& outMesh, int numThreads) {
+    if (hasExtension(filepath, ".obj")) {
+        return loadObj(filepath, material, outMesh, numThreads);
+    }
+    if (hasExtension(filepath, ".ply")) {
+        return loadPly(filepath, material, outMesh, numThreads);
+    }
+    printf("ERROR (`rt::loadMesh`): Unsupported file type %s\n", filepath);
+    return false;
+}
+
+
+// ---------------------------------------- OBJ ----------------------------------------
+
+
+static bool isBlank(char c) {
+    return c == ' ' || c == '\t';
+}
+
+
+static const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && isBlank(*p)) {
+        p++;
+    }
+    return p;
+}
+
+
+static const char* findNextLine(const char* p, const char* end) {
+    const char* newline = (const char*) memchr(p, '\n', end - p);
+    return newline ? newline + 1 : end;
+}
+
+
+static bool isLineEnd(const char* p, const char* end) {
+    return p >= end || *p == '\n' || *p == '\r' || *p == '#';
+}
+
+
+enum class ObjLineType { Other, Position, Normal, Face };
+
+static ObjLineType getObjLineType(const char* p, const char* end) {
+    if (end - p >= 2 && p[0] == 'v' && isBlank(p[1])) {
+        return ObjLineType::Position;
+    }
+    if (end - p >= 3 && p[0] == 'v' && p[1] == 'n' && isBlank(p[2])) {
+        return ObjLineType::Normal;
+    }
+    if (end - p >= 2 && p[0] == 'f' && isBlank(p[1])) {
+        return ObjLineType::Face;
+    }
+    return ObjLineType::Other;
+}
+
+
+static const char* parseVec3(const char* p, const char* end, glm::vec3& out) {
+    for (int i = 0; i < 3; i++) {
+        p = skipBlanks(p, end);
+        auto [next, ec] = std::from_chars(p, end, out[i]);
+        if (ec != std::errc()) {
+            out[i] = 0.0f;
+        }
+        p = next;
+    }
+    return p;
+}
+
+
+struct ObjChunk {
+    const char* begin;
+    const char* end;
+    size_t numPositions = 0;
+    size_t numNormals = 0;
+    size_t numTriangles = 0;
+    // offsets into the whole mesh, from the counts of the previous chunks
+    size_t firstPosition = 0;
+    size_t firstNormal = 0;
+    size_t firstTriangle = 0;
+};
+
+
+// first pass, only counts so that the second one can write straight into the final arrays
+static void countObjChunk(ObjChunk& chunk) {
+    for (const char* p = chunk.begin; p < chunk.end; p = findNextLine(p, chunk.end)) {
+        p = skipBlanks(p, chunk.end);
+        switch (getObjLineType(p, chunk.end)) {
+            case ObjLineType::Position:
+                chunk.numPositions++;
+                break;
+            case ObjLineType::Normal:
+                chunk.numNormals++;
+                break;
+            case ObjLineType::Face: {
+                int numCorners = 0;
+                p++;
+                while (true) {
+                    p = skipBlanks(p, chunk.end);
+                    if (isLineEnd(p, chunk.end)) {
+                        break;
+                    }
+                    numCorners++;
+                    while (p < chunk.end && !isBlank(*p) && !isLineEnd(p, chunk.end)) {
+                        p++;
+                    }
+                }
+                chunk.numTriangles += std::max(0, numCorners - 2);
+                break;
+            }
+            default:
+                break;
+        }
+    }
+}
+
+
+// resolves a 1 based (or negative, relative to the current count) obj index, UINT32_MAX if out of range
+static uint32_t resolveObjIndex(int64_t index, size_t currentCount, size_t totalCount) {
+    int64_t resolved = index > 0 ? index - 1 : (int64_t) currentCount + index;
+    return (resolved >= 0 && resolved < (int64_t) totalCount) ? (uint32_t) resolved : UINT32_MAX;
+}
+
+
+static bool parseObjChunk(const ObjChunk& chunk, size_t totalPositions, size_t totalNormals, Mesh& mesh, std::vector<glm::vec3>& normals, std::vector<uint32_t>& normalIndices) {
+    size_t positionIdx = chunk.firstPosition;
+    size_t normalIdx = chunk.firstNormal;
+    size_t cornerIdx = chunk.firstTriangle * 3;
+
+    for (const char* p = chunk.begin; p < chunk.end; p = findNextLine(p, chunk.end)) {
+        p = skipBlanks(p, chunk.end);
+        switch (getObjLineType(p, chunk.end)) {
+            case ObjLineType::Position:
+                parseVec3(p + 1, chunk.end, mesh.vertices[positionIdx++]);
+                break;
+            case ObjLineType::Normal:
+                parseVec3(p + 2, chunk.end, normals[normalIdx++]);
+                break;
+            case ObjLineType::Face: {
+                // fan triangulation around the first corner
+                uint32_t firstPosition = 0, firstNormal = 0, prevPosition = 0, prevNormal = 0;
+                int numCorners = 0;
+                p++;
+                while (true) {
+                    p = skipBlanks(p, chunk.end);
+                    if (isLineEnd(p, chunk.end)) {
+                        break;
+                    }
+
+                    // v, v/vt, v//vn or v/vt/vn
+                    int64_t indices[3] = {0, 0, 0};
+                    for (int i = 0; i < 3; i++) {
+                        if (p < chunk.end && *p != '/') {
+                            auto [next, ec] = std::from_chars(p, chunk.end, indices[i]);
+                            if (ec != std::errc()) {
+                                return false;
+                            }
+                            p = next;
+                        }
+                        if (p >= chunk.end || *p != '/') {
+                            break;
+                        }
+                        p++;
+                    }
+                    while (p < chunk.end && !isBlank(*p) && !isLineEnd(p, chunk.end)) {
+                        p++;
+                    }
+
+                    // 0 is never a valid index, also what a missing position is left at
+                    uint32_t position = indices[0] == 0 ? UINT32_MAX : resolveObjIndex(indices[0], positionIdx, totalPositions);
+                    uint32_t normal = indices[2] == 0 ? UINT32_MAX : resolveObjIndex(indices[2], normalIdx, totalNormals);
+                    if (position == UINT32_MAX) {
+                        return false;
+                    }
+
+                    if (numCorners == 0) {
+                        firstPosition = position;
+                        firstNormal = normal;
+                    } else if (numCorners >= 2) {
+                        uint32_t trianglePositions[3] = {firstPosition, prevPosition, position};
+                        uint32_t triangleNormals[3] = {firstNormal, prevNormal, normal};
+                        for (int i = 0; i < 3; i++) {
+                            mesh.indices[cornerIdx] = trianglePositions[i];
+                            if (!normalIndices.empty()) {
+                                normalIndices[cornerIdx] = triangleNormals[i];
+                            }
+                            cornerIdx++;
+                        }
+                    }
+                    prevPosition = position;
+                    prevNormal = normal;
+                    numCorners++;
+                }
+                break;
+            }
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+
+// obj indexes positions and normals separately, the mesh needs a single index per vertex
+static void mergeObjNormals(Mesh& mesh, const std::vector<glm::vec3>& normals, const std::vector<uint32_t>& normalIndices) {
+    if (std::all_of(normalIndices.begin(), normalIndices.end(), [](uint32_t index) { return index == UINT32_MAX; })) {
+        return;
+    }
+
+    bool sameIndices = normals.size() == mesh.vertices.size();
+    for (size_t i = 0; i < mesh.indices.size() && sameIndices; i++) {
+        sameIndices = normalIndices[i] == mesh.indices[i];
+    }
+    if (sameIndices) {
+        mesh.normals = normals;
+        return;
+    }
+
+    // one vertex per unique (position, normal) pair, corners without a normal get a zero one
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> vertexNormals;
+    std::unordered_map<uint64_t, uint32_t> vertexIndices;
+    vertexIndices.reserve(mesh.vertices.size());
+    for (size_t i = 0; i < mesh.indices.size(); i++) {
+        uint64_t key = ((uint64_t) mesh.indices[i] << 32) | normalIndices[i];
+        auto [it, inserted] = vertexIndices.try_emplace(key, (uint32_t) vertices.size());
+        if (inserted) {
+            vertices.push_back(mesh.vertices[mesh.indices[i]]);
+            vertexNormals.push_back(normalIndices[i] == UINT32_MAX ? glm::vec3(0.0f) : normals[normalIndices[i]]);
+        }
+        mesh.indices[i] = it->second;
+    }
+    mesh.vertices = std::move(vertices);
+    mesh.normals = std::move(vertexNormals);
+}
+
+
+bool loadObj(const char* filepath, std::shared_ptr<internal::Material> material, Mesh& outMesh, int numThreads) {
+    MappedFile file(filepath);
+    if (!file.isOpen()) {
+        printf("ERROR (`rt::loadObj`): Unable to read %s\n", filepath);
+        return false;
+    }
+
+    // chunks start at the beginning of a line
+    int numChunks = std::max<int>(1, std::min<size_t>(getThreadCount(numThreads), file.size() / 4096));
+    std::vector<ObjChunk> chunks(numChunks);
+    for (int i = 0; i < numChunks; i++) {
+        chunks[i].begin = i == 0 ? file.begin() : chunks[i - 1].end;
+        chunks[i].end = file.end();
+        if (i + 1 < numChunks) {
+            const char* splitPoint = std::max(chunks[i].begin, file.begin() + file.size() * (i + 1) / numChunks);
+            chunks[i].end = findNextLine(splitPoint, file.end());
+        }
+    }
+
+    runChunks(numChunks, [&](int chunkIdx) { countObjChunk(chunks[chunkIdx]); });
+
+    size_t totalPositions = 0, totalNormals = 0, totalTriangles = 0;
+    for (ObjChunk& chunk : chunks) {
+        chunk.firstPosition = totalPositions;
+        chunk.firstNormal = totalNormals;
+        chunk.firstTriangle = totalTriangles;
+        totalPositions += chunk.numPositions;
+        totalNormals += chunk.numNormals;
+        totalTriangles += chunk.numTriangles;
+    }
+
+    Mesh mesh;
+    mesh.material = material;
+    mesh.vertices.resize(totalPositions);
+    mesh.indices.resize(totalTriangles * 3);
+    std::vector<glm::vec3> normals(totalNormals);
+    std::vector<uint32_t> normalIndices(totalNormals > 0 ? totalTriangles * 3 : 0);
+
+    std::atomic<bool> valid = true;
+    runChunks(numChunks, [&](int chunkIdx) {
+        if (!parseObjChunk(chunks[chunkIdx], totalPositions, totalNormals, mesh, normals, normalIndices)) {
+            valid = false;
+        }
+    });
+    if (!valid) {
+        printf("ERROR (`rt::loadObj`): %s has a face with an invalid or out of range index\n", filepath);
+        return false;
+    }
+
+    if (totalNormals > 0) {
+        mergeObjNormals(mesh, normals, normalIndices);
+    }
+
+    outMesh = std::move(mesh);
+    return true;
+}
+
+
+// ---------------------------------------- PLY ----------------------------------------
+
+
+enum class PlyType { Int8, Uint8, Int16, Uint16, Int32, Uint32, Float32, Float64, Invalid };
+
+
+struct PlyProperty {
+    std::string name;
+    PlyType type;
+    // only for list properties
+    bool isList = false;
+    PlyType countType = PlyType::Invalid;
+};
+
+
+struct PlyElement {
+    std::string name;
+    size_t count;
+    std::vector<PlyProperty> properties;
+};
+
+
+static PlyType getPlyType(const std::string& name) {
+    if (name == "char" || name == "int8") return PlyType::Int8;
+    if (name == "uchar" || name == "uint8") return PlyType::Uint8;
+    if (name == "short" || name == "int16") return PlyType::Int16;
+    if (name == "ushort" || name == "uint16") return PlyType::Uint16;
+    if (name == "int" || name == "int32") return PlyType::Int32;
+    if (name == "uint" || name == "uint32") return PlyType::Uint32;
+    if (name == "float" || name == "float32") return PlyType::Float32;
+    if (name == "double" || name == "float64") return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+
+static size_t getPlyTypeSize(PlyType type) {
+    switch (type) {
+        case PlyType::Int8: case PlyType::Uint8: return 1;
+        case PlyType::Int16: case PlyType::Uint16: return 2;
+        case PlyType::Int32: case PlyType::Uint32: case PlyType::Float32: return 4;
+        case PlyType::Float64: return 8;
+        default: return 0;
+    }
+}
+
+
+static double readPlyValue(const char* p, PlyType type, bool bigEndian) {
+    unsigned char bytes[8];
+    size_t size = getPlyTypeSize(type);
+    memcpy(bytes, p, size);
+    if (bigEndian) {
+        std::reverse(bytes, bytes + size);
+    }
+
+    switch (type) {
+        case PlyType::Int8: { int8_t v; memcpy(&v, bytes, 1); return v; }
+        case PlyType::Uint8: { uint8_t v; memcpy(&v, bytes, 1); return v; }
+        case PlyType::Int16: { int16_t v; memcpy(&v, bytes, 2); return v; }
+        case PlyType::Uint16: { uint16_t v; memcpy(&v, bytes, 2); return v; }
+        case PlyType::Int32: { int32_t v; memcpy(&v, bytes, 4); return v; }
+        case PlyType::Uint32: { uint32_t v; memcpy(&v, bytes, 4); return v; }
+        case PlyType::Float32: { float v; memcpy(&v, bytes, 4); return v; }
+        case PlyType::Float64: { double v; memcpy(&v, bytes, 8); return v; }
+        default: return 0.0;
+    }
+}
+
+
+// returns the size of the header (0 if it is invalid)
+static size_t parsePlyHeader(const MappedFile& file, bool& bigEndian, std::vector<PlyElement>& elements) {
+    const char* headerEnd = nullptr;
+    for (const char* p = file.begin(); p < file.end(); p = findNextLine(p, file.end())) {
+        if (file.end() - p >= 10 && memcmp(p, "end_header", 10) == 0) {
+            headerEnd = findNextLine(p, file.end());
+            break;
+        }
+    }
+    if (!headerEnd || file.size() < 3 || memcmp(file.begin(), "ply", 3) != 0) {
+        return 0;
+    }
+
+    std::istringstream header(std::string(file.begin(), headerEnd));
+    std::string line;
+    bool hasFormat = false;
+    while (std::getline(header, line)) {
+        std::istringstream words(line);
+        std::string keyword;
+        words >> keyword;
+
+        if (keyword == "format") {
+            std::string format;
+            words >> format;
+            if (format != "binary_little_endian" && format != "binary_big_endian") {
+                printf("ERROR (`rt::loadPly`): Unsupported format %s, only binary ply files can be loaded\n", format.c_str());
+                return 0;
+            }
+            bigEndian = format == "binary_big_endian";
+            hasFormat = true;
+        } else if (keyword == "element") {
+            PlyElement element;
+            words >> element.name >> element.count;
+            elements.push_back(element);
+        } else if (keyword == "property" && !elements.empty()) {
+            PlyProperty property;
+            std::string typeName;
+            words >> typeName;
+            if (typeName == "list") {
+                std::string countTypeName;
+                words >> countTypeName >> typeName;
+                property.isList = true;
+                property.countType = getPlyType(countTypeName);
+                if (property.countType == PlyType::Invalid) {
+                    return 0;
+                }
+            }
+            property.type = getPlyType(typeName);
+            words >> property.name;
+            if (property.type == PlyType::Invalid) {
+                return 0;
+            }
+            elements.back().properties.push_back(property);
+        }
+    }
+
+    return hasFormat ? headerEnd - file.begin() : 0;
+}
+
+
+// size of every instance of the element, 0 if it has list properties
+static size_t getPlyElementStride(const PlyElement& element) {
+    size_t stride = 0;
+    for (const PlyProperty& property : element.properties) {
+        if (property.isList) {
+            return 0;
+        }
+        stride += getPlyTypeSize(property.type);
+    }
+    return stride;
+}
+
+
+static const char* readPlyVertices(const PlyElement& element, const char* p, const char* end, bool bigEndian, int numThreads, Mesh& mesh) {
+    size_t stride = getPlyElementStride(element);
+    if (stride == 0 || (size_t) (end - p) / stride < element.count) {
+        return nullptr;
+    }
+
+    const char* names[6] = {"x", "y", "z", "nx", "ny", "nz"};
+    int offsets[6] = {-1, -1, -1, -1, -1, -1};
+    PlyType types[6];
+    size_t offset = 0;
+    for (const PlyProperty& property : element.properties) {
+        for (int i = 0; i < 6; i++) {
+            if (property.name == names[i]) {
+                offsets[i] = offset;
+                types[i] = property.type;
+            }
+        }
+        offset += getPlyTypeSize(property.type);
+    }
+    if (offsets[0] == -1 || offsets[1] == -1 || offsets[2] == -1) {
+        return nullptr;
+    }
+    bool hasNormals = offsets[3] != -1 && offsets[4] != -1 && offsets[5] != -1;
+
+    mesh.vertices.resize(element.count);
+    if (hasNormals) {
+        mesh.normals.resize(element.count);
+    }
+
+    // fixed size records, so every chunk knows where it starts
+    int numChunks = std::max<int>(1, std::min<size_t>(numThreads, element.count / 1024));
+    runChunks(numChunks, [&](int chunkIdx) {
+        size_t first = element.count * chunkIdx / numChunks;
+        size_t last = element.count * (chunkIdx + 1) / numChunks;
+        for (size_t i = first; i < last; i++) {
+            const char* vertex = p + i * stride;
+            for (int axis = 0; axis < 3; axis++) {
+                mesh.vertices[i][axis] = readPlyValue(vertex + offsets[axis], types[axis], bigEndian);
+                if (hasNormals) {
+                    mesh.normals[i][axis] = readPlyValue(vertex + offsets[3 + axis], types[3 + axis], bigEndian);
+                }
+            }
+        }
+    });
+
+    return p + element.count * stride;
+}
+
+
+// faces have variable length, so they are read sequentially
+static const char* readPlyFaces(const PlyElement& element, const char* p, const char* end, bool bigEndian, Mesh& mesh) {
+    mesh.indices.reserve(element.count * 3);
+    for (size_t faceIdx = 0; faceIdx < element.count; faceIdx++) {
+        for (const PlyProperty& property : element.properties) {
+            size_t valueSize = getPlyTypeSize(property.type);
+            if (!property.isList) {
+                if ((size_t) (end - p) < valueSize) {
+                    return nullptr;
+                }
+                p += valueSize;
+                continue;
+            }
+
+            size_t countSize = getPlyTypeSize(property.countType);
+            if ((size_t) (end - p) < countSize) {
+                return nullptr;
+            }
+            double count = readPlyValue(p, property.countType, bigEndian);
+            p += countSize;
+            if (count < 0.0 || (size_t) (end - p) / valueSize < count) {
+                return nullptr;
+            }
+
+            if (property.name == "vertex_indices" || property.name == "vertex_index") {
+                // indices outside of the uint32_t range can't be converted (negative ones of signed types)
+                for (size_t i = 0; i < count; i++) {
+                    double index = readPlyValue(p + i * valueSize, property.type, bigEndian);
+                    if (index < 0.0 || index > UINT32_MAX) {
+                        return nullptr;
+                    }
+                }
+                uint32_t first = readPlyValue(p, property.type, bigEndian);
+                for (size_t i = 2; i < count; i++) {
+                    mesh.indices.push_back(first);
+                    mesh.indices.push_back(readPlyValue(p + (i - 1) * valueSize, property.type, bigEndian));
+                    mesh.indices.push_back(readPlyValue(p + i * valueSize, property.type, bigEndian));
+                }
+            }
+            p += (size_t) count * valueSize;
+        }
+    }
+    return p;
+}
+
+
+static const char* skipPlyElement(const PlyElement& element, const char* p, const char* end, bool bigEndian) {
+    size_t stride = getPlyElementStride(element);
+    if (stride != 0) {
+        return (size_t) (end - p) / stride < element.count ? nullptr : p + element.count * stride;
+    }
+
+    for (size_t i = 0; i < element.count; i++) {
+        for (const PlyProperty& property : element.properties) {
+            size_t count = 1;
+            if (property.isList) {
+                if (p + getPlyTypeSize(property.countType) > end) {
+                    return nullptr;
+                }
+                count = readPlyValue(p, property.countType, bigEndian);
+                p += getPlyTypeSize(property.countType);
+            }
+            p += count * getPlyTypeSize(property.type);
+            if (p > end) {
+                return nullptr;
+            }
+        }
+    }
+    return p;
+}
+
+
+bool loadPly(const char* filepath, std::shared_ptr<internal::Material> material, Mesh& outMesh, int numThreads) {
+    MappedFile file(filepath);
+    if (!file.isOpen()) {
+        printf("ERROR (`rt::loadPly`): Unable to read %s\n", filepath);
+        return false;
+    }
+
+    bool bigEndian = false;
+    std::vector<PlyElement> elements;
+    size_t headerSize = parsePlyHeader(file, bigEndian, elements);
+    if (headerSize == 0) {
+        printf("ERROR (`rt::loadPly`): Invalid header in %s\n", filepath);
+        return false;
+    }
+
+    Mesh mesh;
+    mesh.material = material;
+    const char* p = file.begin() + headerSize;
+    for (const PlyElement& element : elements) {
+        if (element.name == "vertex") {
+            p = readPlyVertices(element, p, file.end(), bigEndian, getThreadCount(numThreads), mesh);
+        } else if (element.name == "face") {
+            p = readPlyFaces(element, p, file.end(), bigEndian, mesh);
+        } else {
+            p = skipPlyElement(element, p, file.end(), bigEndian);
+        }
+
+        if (!p) {
+            printf("ERROR (`rt::loadPly`): Unable to read element `%s` of %s\n", element.name.c_str(), filepath);
+            return false;
+        }
+    }
+
+    if (!isValid(mesh)) {
+        return false;
+    }
+    outMesh = std::move(mesh);
+    return true;
+}
+
+}
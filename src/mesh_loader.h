@@ -0,0 +1,20 @@
+
+#pragma once
+
+#include "src/raytracer/mesh.h"
+
+
+namespace rt {
+
+// Loads a .obj or binary .ply file into `outMesh`, picked by the file extension
+// the file is memory mapped and parsed in chunks on `numThreads` threads (0 uses every hardware thread)
+// returns false if the file can't be read or parsed
+bool loadMesh(const char* filepath, std::shared_ptr<internal::Material> material, Mesh& outMesh, int numThreads = 0);
+
+// only positions, normals (vn) and faces are read, faces with more than 3 vertices are triangulated as fans
+bool loadObj(const char* filepath, std::shared_ptr<internal::Material> material, Mesh& outMesh, int numThreads = 0);
+
+// binary (little or big endian) only, reads x/y/z, nx/ny/nz and the vertex_indices (or vertex_index) list
+bool loadPly(const char* filepath, std::shared_ptr<internal::Material> material, Mesh& outMesh, int numThreads = 0);
+
+}
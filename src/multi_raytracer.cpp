@@ -0,0 +1,169 @@
+
+#include "src/multi_raytracer.h"
+#include <stb/stb_image_write.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+// weight of the latest frame when smoothing the measured throughputs
+#define RT_MULTI_DEVICE_THROUGHPUT_SMOOTHING 0.5
+
+
+namespace rt {
+
+MultiDeviceRaytracer::MultiDeviceRaytracer(glm::ivec2 imageShape, const std::vector<CL_Objects>& devices, Format format, Pipeline pipeline) {
+    m_imageShape = imageShape;
+    m_format = format;
+
+    if (devices.empty()) {
+        printf("ERROR (`MultiDeviceRaytracer`): No devices given\n");
+    }
+
+    for (const CL_Objects& clObjects : devices) {
+        m_raytracers.emplace_back(imageShape, clObjects, format, false, 0, pipeline);
+
+        // only used to size the bands of the first frame
+        double computeUnits = clObjects.device.getInfo<CL_DEVICE_MAX_COMPUTE_UNITS>();
+        double clockFrequency = clObjects.device.getInfo<CL_DEVICE_MAX_CLOCK_FREQUENCY>();
+        m_throughputs.push_back(std::max(1.0, computeUnits * clockFrequency));
+    }
+
+    // built up front, otherwise `submitRegion` would build them lazily while the first frame is being timed
+    createClKernels();
+
+    m_pixels.resize(m_raytracers.empty() ? 0 : m_raytracers[0].getPixelBufferSize());
+    m_bandRows.resize(m_raytracers.size(), 0);
+    m_deviceTimes.resize(m_raytracers.size(), 0.0);
+}
+
+
+MultiDeviceScene MultiDeviceRaytracer::convertScene(const Scene& scene, bool buildBvh) const {
+    MultiDeviceScene res;
+    for (const Raytracer& raytracer : m_raytracers) {
+        res.perDevice.push_back(convert(scene, raytracer.getCl().context, raytracer.getCl().queue, buildBvh));
+    }
+    return res;
+}
+
+
+void MultiDeviceRaytracer::createClKernels() {
+    for (Raytracer& raytracer : m_raytracers) {
+        raytracer.createClKernels();
+    }
+}
+
+
+void MultiDeviceRaytracer::createClKernels(const Config& config) {
+    for (Raytracer& raytracer : m_raytracers) {
+        raytracer.createClKernels(config);
+    }
+}
+
+
+// splits the rows proportionally to the throughputs, every device keeps at least one row so that it can still be measured
+void MultiDeviceRaytracer::updateBandRows() {
+    int numDevices = m_raytracers.size();
+    double totalThroughput = 0.0;
+    for (double throughput : m_throughputs) {
+        totalThroughput += throughput;
+    }
+
+    int assignedRows = 0;
+    double cumulativeThroughput = 0.0;
+    for (int i = 0; i < numDevices; i++) {
+        cumulativeThroughput += m_throughputs[i];
+        int bandEnd = (i == numDevices - 1) ? m_imageShape.y : (int) (m_imageShape.y * cumulativeThroughput / totalThroughput + 0.5);
+        m_bandRows[i] = bandEnd - assignedRows;
+        assignedRows = bandEnd;
+    }
+
+    if (m_imageShape.y < numDevices) {
+        return;
+    }
+    for (int i = 0; i < numDevices; i++) {
+        if (m_bandRows[i] == 0) {
+            int largestIdx = std::max_element(m_bandRows.begin(), m_bandRows.end()) - m_bandRows.begin();
+            m_bandRows[largestIdx]--;
+            m_bandRows[i]++;
+        }
+    }
+}
+
+
+void MultiDeviceRaytracer::renderScene(const MultiDeviceScene& scene, const internal::Camera& camera, const Config& config) {
+    if (scene.perDevice.size() != m_raytracers.size()) {
+        printf("ERROR (`MultiDeviceRaytracer::renderScene`): Scene was converted for %d devices instead of %d\n", (int) scene.perDevice.size(), (int) m_raytracers.size());
+        return;
+    }
+
+    updateBandRows();
+
+    size_t rowPitch = m_pixels.size() / m_imageShape.y;
+    std::vector<FrameFence> fences(m_raytracers.size());
+    // every device is timed from its own submit, the earlier submits would count towards the later devices otherwise
+    std::vector<std::chrono::high_resolution_clock::time_point> submitTimes(m_raytracers.size());
+
+    int bandStart = 0;
+    for (int i = 0; i < m_raytracers.size(); i++) {
+        if (m_bandRows[i] == 0) {
+            continue;
+        }
+        glm::ivec2 origin = {0, bandStart};
+        glm::ivec2 size = {m_imageShape.x, m_bandRows[i]};
+        // the readback is on the same (in-order) queue, so its event also marks the end of the render
+        submitTimes[i] = std::chrono::high_resolution_clock::now();
+        m_raytracers[i].submitRegion(scene.perDevice[i], camera, config, origin, size);
+        fences[i] = m_raytracers[i].requestRegionReadback(origin, size, m_pixels.data() + bandStart * rowPitch, rowPitch);
+        bandStart += m_bandRows[i];
+    }
+
+    // polling instead of waiting in order, to get the time at which each device finished
+    std::vector<bool> finished(m_raytracers.size(), false);
+    int numFinished = 0;
+    while (numFinished < m_raytracers.size()) {
+        for (int i = 0; i < m_raytracers.size(); i++) {
+            if (finished[i] || !fences[i].isComplete()) {
+                continue;
+            }
+            auto timeTaken_ns = (std::chrono::high_resolution_clock::now() - submitTimes[i]).count();
+            m_deviceTimes[i] = (double) timeTaken_ns / 1'000'000'000;
+            finished[i] = true;
+            numFinished++;
+        }
+        if (numFinished < m_raytracers.size()) {
+            std::this_thread::yield();
+        }
+    }
+
+    bool firstMeasurement = !m_hasMeasuredThroughputs;
+    for (int i = 0; i < m_raytracers.size(); i++) {
+        if (m_bandRows[i] == 0 || m_deviceTimes[i] <= 0.0) {
+            continue;
+        }
+        double throughput = (double) m_bandRows[i] * m_imageShape.x / m_deviceTimes[i];
+        if (firstMeasurement) {
+            m_throughputs[i] = throughput;
+        } else {
+            double alpha = RT_MULTI_DEVICE_THROUGHPUT_SMOOTHING;
+            m_throughputs[i] = alpha * throughput + (1.0 - alpha) * m_throughputs[i];
+        }
+        m_hasMeasuredThroughputs = true;
+    }
+}
+
+
+void MultiDeviceRaytracer::readPixels(void* outBuffer) const {
+    std::copy(m_pixels.begin(), m_pixels.end(), (uint8_t*) outBuffer);
+}
+
+
+bool MultiDeviceRaytracer::saveAsImage(const char* filepath) const {
+    if (m_format != Format::RGBA8) {
+        printf("ERROR (`MultiDeviceRaytracer::saveAsImage`): Cannot save image for Format::%d\n", m_format);
+        return false;
+    }
+
+    return stbi_write_png(filepath, m_imageShape.x, m_imageShape.y, 4, m_pixels.data(), 0);
+}
+
+}
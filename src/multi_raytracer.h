@@ -0,0 +1,60 @@
+
+#pragma once
+
+#include "src/raytracer.h"
+#include <vector>
+
+
+namespace rt {
+
+// A scene uploaded to every device of a MultiDeviceRaytracer (indexed like the devices)
+struct MultiDeviceScene {
+    std::vector<internal::Scene> perDevice;
+};
+
+
+// Renders each frame on several devices at once, every device gets a band of rows
+// sized by its measured throughput in the previous frames
+// the bands are read back into a single host image, so accumulation and gl-interop are not available
+class MultiDeviceRaytracer {
+
+    public:
+        MultiDeviceRaytracer(glm::ivec2 imageShape, const std::vector<CL_Objects>& devices, Format format, Pipeline pipeline = Pipeline::Megakernel);
+        // converts the scene and creates its buffers in every device's context
+        MultiDeviceScene convertScene(const Scene& scene, bool buildBvh = true) const;
+        void renderScene(const MultiDeviceScene& scene, const internal::Camera& camera, const Config& config);
+        void readPixels(void* outBuffer) const;
+        bool saveAsImage(const char* filepath) const;
+
+        // the generic kernels are built by the constructor, so that no build is timed as part of a frame
+        // specialised ones are only used once built here (on every device)
+        void createClKernels();
+        void createClKernels(const Config& config);
+
+        size_t getDeviceCount() const { return m_raytracers.size(); }
+        Raytracer& getRaytracer(size_t deviceIdx) { return m_raytracers[deviceIdx]; }
+        // rows given to each device in the last frame
+        const std::vector<int>& getBandRows() const { return m_bandRows; }
+        // seconds each device took (render + readback) in the last frame
+        const std::vector<double>& getDeviceTimes() const { return m_deviceTimes; }
+        const glm::ivec2& getImageShape() const { return m_imageShape; }
+        uint32_t getPixelBufferSize() const { return m_pixels.size(); }
+
+    private:
+        void updateBandRows();
+
+    private:
+        glm::ivec2 m_imageShape;
+        Format m_format;
+        std::vector<Raytracer> m_raytracers;
+        std::vector<uint8_t> m_pixels;
+
+        // pixels per second, until the first frame it is just an estimate from the device info
+        std::vector<double> m_throughputs;
+        bool m_hasMeasuredThroughputs = false;
+        std::vector<int> m_bandRows;
+        std::vector<double> m_deviceTimes;
+
+};
+
+}
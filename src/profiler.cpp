@@ -0,0 +1,129 @@
+
+#include "src/profiler.h"
+#include <algorithm>
+#include <cfloat>
+#include <fstream>
+
+
+namespace rt {
+
+void Profiler::record(const char* name, const cl::Event& event) {
+    m_pending.push_back({name, m_frame, event});
+}
+
+
+void Profiler::collect(bool wait) {
+    auto isDone = [&](PendingCommand& command) {
+        if (wait) {
+            command.event.wait();
+        }
+        cl_int status = command.event.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>();
+        if (status > CL_COMPLETE) {
+            return false;
+        }
+        // failed commands (negative status) have no valid timestamps
+        if (status < CL_COMPLETE) {
+            m_numFailedCommands++;
+            return true;
+        }
+
+        CommandTiming timing;
+        timing.name = command.name;
+        timing.frame = command.frame;
+        timing.queued = command.event.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>();
+        timing.submit = command.event.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>();
+        timing.start = command.event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        timing.end = command.event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+        m_timings.push_back(timing);
+        return true;
+    };
+
+    m_pending.erase(std::remove_if(m_pending.begin(), m_pending.end(), isDone), m_pending.end());
+}
+
+
+void Profiler::clear() {
+    m_pending.clear();
+    m_timings.clear();
+    m_numFailedCommands = 0;
+}
+
+
+bool Profiler::getLastFrameStats(FrameStats& out) const {
+    // a frame is only complete once none of its commands are pending
+    uint32_t firstPendingFrame = UINT32_MAX;
+    for (const PendingCommand& command : m_pending) {
+        firstPendingFrame = std::min(firstPendingFrame, command.frame);
+    }
+
+    bool found = false;
+    uint32_t lastFrame = 0;
+    for (const CommandTiming& timing : m_timings) {
+        if (timing.frame < firstPendingFrame && (!found || timing.frame > lastFrame)) {
+            lastFrame = timing.frame;
+            found = true;
+        }
+    }
+
+    if (found) {
+        out = getFrameStats(lastFrame);
+    }
+    return found;
+}
+
+
+FrameStats Profiler::getFrameStats(uint32_t frame) const {
+    FrameStats stats;
+    stats.frame = frame;
+
+    cl_ulong firstStart = UINT64_MAX, lastEnd = 0;
+    for (const CommandTiming& timing : m_timings) {
+        if (timing.frame != frame) {
+            continue;
+        }
+        stats.numCommands++;
+        stats.commandMs[timing.name] += (double) (timing.end - timing.start) / 1'000'000;
+        firstStart = std::min(firstStart, timing.start);
+        lastEnd = std::max(lastEnd, timing.end);
+    }
+
+    if (stats.numCommands != 0) {
+        stats.totalMs = (double) (lastEnd - firstStart) / 1'000'000;
+    }
+    return stats;
+}
+
+
+bool Profiler::exportChromeTrace(const char* filepath) const {
+    std::ofstream file(filepath);
+    if (!file) {
+        printf("ERROR (`Profiler::exportChromeTrace`): Unable to write %s\n", filepath);
+        return false;
+    }
+
+    cl_ulong firstQueued = UINT64_MAX;
+    for (const CommandTiming& timing : m_timings) {
+        firstQueued = std::min(firstQueued, timing.queued);
+    }
+
+    // one row for the time spent executing, another for the time spent waiting in the queue
+    char line[512];
+    file << "{\"traceEvents\": [\n";
+    file << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 0, \"args\": {\"name\": \"device\"}},\n";
+    file << "  {\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 0, \"tid\": 1, \"args\": {\"name\": \"queue\"}}";
+    for (const CommandTiming& timing : m_timings) {
+        snprintf(
+            line, sizeof(line),
+            ",\n  {\"name\": \"%s\", \"ph\": \"X\", \"pid\": 0, \"tid\": 0, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"frame\": %u}},\n"
+            "  {\"name\": \"%s (waiting)\", \"ph\": \"X\", \"pid\": 0, \"tid\": 1, \"ts\": %.3f, \"dur\": %.3f, \"args\": {\"frame\": %u, \"submit_us\": %.3f}}",
+            timing.name.c_str(), (double) (timing.start - firstQueued) / 1000, (double) (timing.end - timing.start) / 1000, timing.frame,
+            timing.name.c_str(), (double) (timing.queued - firstQueued) / 1000, (double) (timing.start - timing.queued) / 1000, timing.frame,
+            (double) (timing.submit - timing.queued) / 1000
+        );
+        file << line;
+    }
+    file << "\n]}\n";
+    return (bool) file;
+}
+
+}
@@ -0,0 +1,71 @@
+
+#pragma once
+
+#include "src/clutils.h"
+#include <map>
+#include <string>
+#include <vector>
+
+
+namespace rt {
+
+// Device timestamps (nanoseconds) of a single command
+struct CommandTiming {
+    std::string name;
+    uint32_t frame;
+    cl_ulong queued;
+    cl_ulong submit;
+    cl_ulong start;
+    cl_ulong end;
+};
+
+
+// Device time spent per command name in a frame
+struct FrameStats {
+    uint32_t frame = 0;
+    uint32_t numCommands = 0;
+    // first start to last end
+    double totalMs = 0.0;
+    // sum of (end - start) per command name
+    std::map<std::string, double> commandMs;
+};
+
+
+// Collects the profiling info of the commands enqueued by a Raytracer
+// the queue has to be created with profiling enabled (see `createClObjects`)
+class Profiler {
+
+    public:
+        // commands recorded after this belong to a new frame
+        void beginFrame() { m_frame++; }
+        // the timestamps are read once the event completes (in `collect`)
+        void record(const char* name, const cl::Event& event);
+        // reads the timestamps of the completed commands, `wait` blocks until every recorded command is done
+        void collect(bool wait = false);
+        void clear();
+
+        uint32_t getFrame() const { return m_frame; }
+        const std::vector<CommandTiming>& getTimings() const { return m_timings; }
+        // commands that ended with an error, they are dropped instead of timed
+        uint32_t getNumFailedCommands() const { return m_numFailedCommands; }
+        // stats of the most recent frame whose commands have all completed, false if there is none
+        bool getLastFrameStats(FrameStats& out) const;
+        FrameStats getFrameStats(uint32_t frame) const;
+        // trace event format json, can be opened in chrome://tracing or perfetto
+        bool exportChromeTrace(const char* filepath) const;
+
+    private:
+        struct PendingCommand {
+            std::string name;
+            uint32_t frame;
+            cl::Event event;
+        };
+
+        uint32_t m_frame = 0;
+        std::vector<PendingCommand> m_pending;
+        std::vector<CommandTiming> m_timings;
+        uint32_t m_numFailedCommands = 0;
+
+};
+
+}
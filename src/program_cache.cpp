@@ -0,0 +1,213 @@
+
+#include "src/program_cache.h"
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <random>
+#include <set>
+#include <sstream>
+#ifdef _WIN32
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+
+
+namespace rt {
+
+static const char CACHE_FILE_MAGIC[] = "RTCLBIN1";
+
+
+static std::string& cacheDirStorage() {
+    static std::string cacheDir = [] {
+        const char* env = std::getenv("RT_CL_CACHE_DIR");
+        return std::string(env ? env : ".clcache");
+    }();
+    return cacheDir;
+}
+
+
+std::string getClCacheDir() {
+    return cacheDirStorage();
+}
+
+
+void setClCacheDir(const std::string& cacheDir) {
+    cacheDirStorage() = cacheDir;
+}
+
+
+static bool readBinaryFile(const std::filesystem::path& filepath, std::vector<unsigned char>& out) {
+    std::ifstream file(filepath, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!file) {
+        return false;
+    }
+    out.resize(file.tellg());
+    file.seekg(0);
+    file.read((char*) out.data(), out.size());
+    return (bool) file;
+}
+
+
+// appends the source along with every file it #include's (paths are relative to the working directory like for the cl compiler)
+static void appendSourceWithIncludes(const std::string& source, std::set<std::string>& visited, std::string& out) {
+    out += source;
+
+    std::istringstream stream(source);
+    std::string line;
+    while (std::getline(stream, line)) {
+        size_t includePos = line.find("#include \"");
+        if (includePos == std::string::npos) {
+            continue;
+        }
+        size_t pathStart = includePos + 10;
+        size_t pathEnd = line.find('"', pathStart);
+        std::string includePath = line.substr(pathStart, pathEnd - pathStart);
+        if (!visited.insert(includePath).second) {
+            continue;
+        }
+
+        std::vector<unsigned char> contents;
+        if (readBinaryFile(includePath, contents)) {
+            appendSourceWithIncludes(std::string(contents.begin(), contents.end()), visited, out);
+        }
+    }
+}
+
+
+// everything that invalidates a compiled binary
+static std::string makeCacheKey(const CL_Objects& clObjects, const std::string& source, const std::string& buildFlags) {
+    std::string key;
+    key += clObjects.platform.getInfo<CL_PLATFORM_NAME>() + "\n";
+    key += clObjects.platform.getInfo<CL_PLATFORM_VERSION>() + "\n";
+    key += clObjects.device.getInfo<CL_DEVICE_NAME>() + "\n";
+    key += clObjects.device.getInfo<CL_DEVICE_VENDOR>() + "\n";
+    key += clObjects.device.getInfo<CL_DEVICE_VERSION>() + "\n";
+    key += clObjects.device.getInfo<CL_DRIVER_VERSION>() + "\n";
+    key += buildFlags + "\n";
+
+    std::set<std::string> visited;
+    appendSourceWithIncludes(source, visited, key);
+    return key;
+}
+
+
+// 64 bit FNV-1a
+static uint64_t hashString(const std::string& str) {
+    uint64_t hash = 14695981039346656037ull;
+    for (unsigned char c : str) {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+
+static std::filesystem::path getCacheFilepath(const std::string& key) {
+    char filename[32];
+    snprintf(filename, sizeof(filename), "%016llx.bin", (unsigned long long) hashString(key));
+    return std::filesystem::path(getClCacheDir()) / filename;
+}
+
+
+// file layout: magic | key length (u64) | key | binary
+static bool loadCachedBinary(const std::filesystem::path& filepath, const std::string& key, std::vector<unsigned char>& outBinary) {
+    std::vector<unsigned char> contents;
+    if (!readBinaryFile(filepath, contents)) {
+        return false;
+    }
+
+    size_t headerSize = sizeof(CACHE_FILE_MAGIC) + sizeof(uint64_t);
+    if (contents.size() < headerSize || memcmp(contents.data(), CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC)) != 0) {
+        return false;
+    }
+
+    uint64_t keySize;
+    memcpy(&keySize, contents.data() + sizeof(CACHE_FILE_MAGIC), sizeof(uint64_t));
+    if (contents.size() < headerSize + keySize || keySize != key.size() || memcmp(contents.data() + headerSize, key.data(), keySize) != 0) {
+        // hash collision or stale file
+        return false;
+    }
+
+    outBinary.assign(contents.begin() + headerSize + keySize, contents.end());
+    return !outBinary.empty();
+}
+
+
+static void storeCachedBinary(const std::filesystem::path& filepath, const std::string& key, const std::vector<unsigned char>& binary) {
+    std::error_code ec;
+    std::filesystem::create_directories(filepath.parent_path(), ec);
+
+    // writing to a temporary first so that concurrent runs never see a partial file
+    // its name is unique per process and call, so that concurrent builds of the same program don't write into the same one
+    thread_local std::mt19937_64 random(std::random_device{}());
+    std::filesystem::path tempFilepath = filepath;
+    tempFilepath += "." + std::to_string(getpid()) + "." + std::to_string(random()) + ".tmp";
+    {
+        std::ofstream file(tempFilepath, std::ios::out | std::ios::binary | std::ios::trunc);
+        uint64_t keySize = key.size();
+        file.write(CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC));
+        file.write((const char*) &keySize, sizeof(uint64_t));
+        file.write(key.data(), key.size());
+        file.write((const char*) binary.data(), binary.size());
+        if (!file) {
+            printf("WARN (`storeCachedBinary`): Unable to write %s\n", tempFilepath.string().c_str());
+            file.close();
+            std::filesystem::remove(tempFilepath, ec);
+            return;
+        }
+    }
+    std::filesystem::rename(tempFilepath, filepath, ec);
+    if (ec) {
+        printf("WARN (`storeCachedBinary`): Unable to write %s\n", filepath.string().c_str());
+        std::filesystem::remove(tempFilepath, ec);
+    }
+}
+
+
+bool buildClProgram(const CL_Objects& clObjects, const std::string& source, const std::string& buildFlags, cl::Program& outProgram, bool* fromCache) {
+    bool useCache = !getClCacheDir().empty();
+    if (fromCache) {
+        *fromCache = false;
+    }
+
+    std::string key;
+    std::filesystem::path cacheFilepath;
+    if (useCache) {
+        key = makeCacheKey(clObjects, source, buildFlags);
+        cacheFilepath = getCacheFilepath(key);
+
+        std::vector<unsigned char> binary;
+        if (loadCachedBinary(cacheFilepath, key, binary)) {
+            int err;
+            std::vector<cl_int> binaryStatus;
+            cl::Program program(clObjects.context, {clObjects.device}, cl::Program::Binaries{binary}, &binaryStatus, &err);
+            if (err == CL_SUCCESS && program.build({clObjects.device}, buildFlags.c_str()) == CL_SUCCESS) {
+                outProgram = program;
+                if (fromCache) {
+                    *fromCache = true;
+                }
+                return true;
+            }
+            printf("WARN (`buildClProgram`): Cached binary %s was rejected, rebuilding from source\n", cacheFilepath.string().c_str());
+        }
+    }
+
+    cl::Program program(clObjects.context, source);
+    if (program.build({clObjects.device}, buildFlags.c_str()) != CL_SUCCESS) {
+        outProgram = program;
+        return false;
+    }
+    outProgram = program;
+
+    if (useCache) {
+        std::vector<std::vector<unsigned char>> binaries = program.getInfo<CL_PROGRAM_BINARIES>();
+        if (!binaries.empty() && !binaries[0].empty()) {
+            storeCachedBinary(cacheFilepath, key, binaries[0]);
+        }
+    }
+    return true;
+}
+
+}
@@ -0,0 +1,23 @@
+
+#pragma once
+
+#include "src/clutils.h"
+#include <string>
+
+
+namespace rt {
+
+// Directory where compiled program binaries are stored
+// defaults to `.clcache`, can be overridden with the RT_CL_CACHE_DIR env variable
+// an empty string disables the cache
+std::string getClCacheDir();
+void setClCacheDir(const std::string& cacheDir);
+
+
+// Builds `source` for `clObjects.device`, reusing a cached binary if one exists for the same
+// source (including the files it #include's), build flags and device/driver.
+// Falls back to building from source if the cached binary is missing or rejected.
+// `fromCache` (optional) is set to whether the cached binary was used
+bool buildClProgram(const CL_Objects& clObjects, const std::string& source, const std::string& buildFlags, cl::Program& outProgram, bool* fromCache = nullptr);
+
+}
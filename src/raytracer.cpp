@@ -1,12 +1,20 @@
 
 #include "src/raytracer.h"
+#include "src/program_cache.h"
 #include <stb/stb_image_write.h>
+#include <algorithm>
+#include <chrono>
 #include <sstream>
 #include <fstream>
 
 
 namespace rt {
 
+// sizes of rt_PathState and rt_HitRecord in the kernels
+static const size_t PATH_STATE_SIZE = 96;
+static const size_t HIT_RECORD_SIZE = 64;
+
+
 std::string readFile(const char* filepath) {
     std::ifstream file(filepath, std::ios::in | std::ios::ate);
 
@@ -39,12 +47,13 @@ cl::ImageFormat getClImageFormat(Format format) {
 }
 
 
-Raytracer::Raytracer(glm::ivec2 imageShape, CL_Objects clObjects, Format format, bool allowAccumulation, uint32_t glTextureId) {
+Raytracer::Raytracer(glm::ivec2 imageShape, CL_Objects clObjects, Format format, bool allowAccumulation, uint32_t glTextureId, Pipeline pipeline) {
     m_imageShape = imageShape;
     m_clObjects = clObjects;
     m_format = format;
     m_allowAccumulation = allowAccumulation;
     m_clGlInterop = glTextureId != 0;
+    m_pipeline = pipeline;
 
     if (m_clGlInterop) {
         createImageBuffers(glTextureId);
@@ -52,50 +61,489 @@ Raytracer::Raytracer(glm::ivec2 imageShape, CL_Objects clObjects, Format format,
         createImageBuffers();
     }
 
-    if (m_format == Format::RGBA8 && m_allowAccumulation) {
-        printf("WARN: Using RGBA8 format with accumulation gives bad results\n");
+    if (m_allowAccumulation) {
+        createAccumulationBuffers();
+    }
+
+    if (m_pipeline == Pipeline::Wavefront) {
+        createWavefrontBuffers();
     }
 }
 
 
 void Raytracer::renderScene(const internal::Scene& scene, const internal::Camera& camera, const Config& config) {
-    if (m_kernels.count(config) == 0) {
-        createClKernels(config);
+    if (m_genericKernel() == nullptr) {
+        createClKernels();
+    }
+    if (m_profiler) {
+        m_profiler->beginFrame();
+    }
+
+    enqueueRenderRegion(scene, camera, config, {0, 0}, m_imageShape, nullptr);
+    m_clObjects.queue.finish();
+}
+
+
+bool Raytracer::renderSceneTiled(const internal::Scene& scene, const internal::Camera& camera, const Config& config, TiledRenderState& state, const TileCallback& callback) {
+    if (m_genericKernel() == nullptr) {
+        createClKernels();
+    }
+    if (m_profiler) {
+        m_profiler->beginFrame();
+    }
+
+    glm::ivec2 tileSize = {std::max(1, state.tileSize.x), std::max(1, state.tileSize.y)};
+    glm::ivec2 tileGrid = (m_imageShape + tileSize - glm::ivec2(1)) / tileSize;
+    uint32_t tileCount = tileGrid.x * tileGrid.y;
+
+    // starting over if the state belongs to a different image/tile shape
+    if (state.completedTiles.size() != tileCount) {
+        state.completedTiles.assign(tileCount, false);
+        state.numCompletedTiles = 0;
+    }
+
+    std::vector<uint32_t> tileOrder = makeTileOrder(tileGrid, state.order);
+    tileOrder.erase(std::remove_if(tileOrder.begin(), tileOrder.end(), [&](uint32_t tileIdx) {
+        return state.completedTiles[tileIdx];
+    }), tileOrder.end());
+
+    auto getTileRegion = [&](uint32_t tileIdx, glm::ivec2& origin, glm::ivec2& size) {
+        origin = glm::ivec2(tileIdx % tileGrid.x, tileIdx / tileGrid.x) * tileSize;
+        size = glm::ivec2(std::min(tileSize.x, m_imageShape.x - origin.x), std::min(tileSize.y, m_imageShape.y - origin.y));
+    };
+
+    // keeping two tiles in flight so that the device doesn't idle while the host waits and runs the callback
+    std::vector<cl::Event> tileEvents(tileOrder.size());
+    uint32_t numEnqueued = 0;
+    auto enqueueNextTile = [&]() {
+        if (numEnqueued < tileOrder.size()) {
+            glm::ivec2 origin, size;
+            getTileRegion(tileOrder[numEnqueued], origin, size);
+            enqueueRenderRegion(scene, camera, config, origin, size, &tileEvents[numEnqueued]);
+            m_clObjects.queue.flush();
+            numEnqueued++;
+        }
+    };
+    enqueueNextTile();
+    enqueueNextTile();
+
+    bool cancelled = false;
+    for (uint32_t i = 0; i < numEnqueued; i++) {
+        tileEvents[i].wait();
+        state.completedTiles[tileOrder[i]] = true;
+        state.numCompletedTiles++;
+
+        if (cancelled) {
+            // only finishing the tiles that were already in flight
+            continue;
+        }
+        enqueueNextTile();
+
+        if (callback) {
+            TileProgress progress;
+            getTileRegion(tileOrder[i], progress.tileOrigin, progress.tileSize);
+            progress.numCompletedTiles = state.numCompletedTiles;
+            progress.tileCount = tileCount;
+            cancelled = !callback(progress);
+        }
+    }
+
+    return state.isComplete();
+}
+
+
+bool Raytracer::renderSceneAdaptive(const internal::Scene& scene, const internal::Camera& camera, const Config& config, const AdaptiveSampling& settings, AdaptiveSamplingStats* outStats) {
+    if (!m_allowAccumulation) {
+        printf("ERROR (`Raytracer::renderSceneAdaptive`): Adaptive sampling needs a raytracer that allows accumulation\n");
+        return false;
+    }
+    if (m_genericKernel() == nullptr) {
+        createClKernels();
+    }
+    if (m_profiler) {
+        m_profiler->beginFrame();
+    }
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+    glm::ivec2 tileSize = {std::max(1, settings.tileSize.x), std::max(1, settings.tileSize.y)};
+    glm::ivec2 tileGrid = (m_imageShape + tileSize - glm::ivec2(1)) / tileSize;
+    uint32_t tileCount = tileGrid.x * tileGrid.y;
+    uint32_t numPixels = m_imageShape.x * m_imageShape.y;
+    createAdaptiveBuffers(tileCount);
+
+    std::vector<cl_uint> activeTiles(tileCount, 1);
+    cl_float4 zero = {0.0f, 0.0f, 0.0f, 0.0f};
+    m_clObjects.queue.enqueueFillBuffer(m_pixelStatsBuffer, zero, 0, numPixels * sizeof(cl_float4));
+    m_clObjects.queue.enqueueWriteBuffer(m_activeTilesBuffer, false, 0, tileCount * sizeof(cl_uint), activeTiles.data());
+
+    // the frames are rendered into one accumulation buffer and averaged into the other, only the mean is converted to the output format
+    m_adaptiveAccumulatorKernel.setArg(0, m_accumBuffers[1 - m_accumBufferIdx]);
+    m_adaptiveAccumulatorKernel.setArg(1, m_accumBuffers[m_accumBufferIdx]);
+    if (m_clGlInterop) {
+        m_adaptiveAccumulatorKernel.setArg(2, m_accumImageGl);
+    } else {
+        m_adaptiveAccumulatorKernel.setArg(2, m_accumImage);
+    }
+    m_adaptiveAccumulatorKernel.setArg(3, m_pixelStatsBuffer);
+    m_adaptiveAccumulatorKernel.setArg(4, m_activeTilesBuffer);
+    m_adaptiveAccumulatorKernel.setArg(5, sizeof(cl_int2), &tileSize);
+    m_adaptiveAccumulatorKernel.setArg(6, sizeof(uint32_t), &m_imageShape.x);
+
+    m_activeTilesKernel.setArg(0, m_pixelStatsBuffer);
+    m_activeTilesKernel.setArg(1, m_activeTilesBuffer);
+    m_activeTilesKernel.setArg(2, sizeof(cl_int2), &m_imageShape);
+    m_activeTilesKernel.setArg(3, sizeof(cl_int2), &tileSize);
+    m_activeTilesKernel.setArg(4, sizeof(float), &settings.noiseThreshold);
+    m_activeTilesKernel.setArg(5, sizeof(uint32_t), &settings.minFrames);
+
+    AdaptiveSamplingStats stats = {};
+    stats.tileCount = tileCount;
+    stats.numActiveTiles = tileCount;
+    while (stats.numActiveTiles > 0 && stats.numFrames < settings.maxFrames) {
+        if (settings.timeBudget > 0.0 && (double) (std::chrono::high_resolution_clock::now() - startTime).count() / 1'000'000'000 >= settings.timeBudget) {
+            break;
+        }
+
+        // neighbouring active tiles of a row are rendered with a single dispatch
+        for (int y = 0; y < tileGrid.y; y++) {
+            for (int x = 0; x < tileGrid.x; x++) {
+                if (!activeTiles[y * tileGrid.x + x]) {
+                    continue;
+                }
+                int first = x;
+                while (x + 1 < tileGrid.x && activeTiles[y * tileGrid.x + x + 1]) {
+                    x++;
+                }
+                glm::ivec2 origin = glm::ivec2(first, y) * tileSize;
+                glm::ivec2 size = glm::ivec2(std::min((x + 1) * tileSize.x, m_imageShape.x), std::min((y + 1) * tileSize.y, m_imageShape.y)) - origin;
+                enqueueRenderRegion(scene, camera, config, origin, size, nullptr, FrameOutput::AdaptiveRadiance);
+                stats.numPixelFrames += size.x * size.y;
+            }
+        }
+
+        enqueueKernel("accumulateAdaptive", m_adaptiveAccumulatorKernel, cl::NullRange, cl::NDRange(numPixels));
+        enqueueKernel("updateActiveTiles", m_activeTilesKernel, cl::NullRange, cl::NDRange(tileCount));
+        m_frameCount++;
+        stats.numFrames++;
+
+        cl::Event profilingEvent;
+        cl::Event* event = getProfilingEvent(nullptr, profilingEvent);
+        m_clObjects.queue.enqueueReadBuffer(m_activeTilesBuffer, true, 0, tileCount * sizeof(cl_uint), activeTiles.data(), nullptr, event);
+        recordCommand("read", event);
+        stats.numActiveTiles = std::count(activeTiles.begin(), activeTiles.end(), 1u);
+    }
+
+    stats.time = (double) (std::chrono::high_resolution_clock::now() - startTime).count() / 1'000'000'000;
+    // the result is only in the accumulation image, so accumulating after it starts over
+    resetFrameCount();
+    if (outStats) {
+        *outStats = stats;
+    }
+    return stats.numActiveTiles == 0;
+}
+
+
+std::vector<uint32_t> Raytracer::makeTileOrder(glm::ivec2 tileGrid, TileOrder order) const {
+    std::vector<uint32_t> tileOrder(tileGrid.x * tileGrid.y);
+    for (uint32_t i = 0; i < tileOrder.size(); i++) {
+        tileOrder[i] = i;
     }
 
-    cl::Kernel raytracerKernel = m_kernels[config];
+    if (order == TileOrder::CenterOut) {
+        glm::vec2 center = glm::vec2(tileGrid.x - 1, tileGrid.y - 1) * 0.5f;
+        auto distanceToCenter = [&](uint32_t tileIdx) {
+            glm::vec2 offset = glm::vec2(tileIdx % tileGrid.x, tileIdx / tileGrid.x) - center;
+            return offset.x * offset.x + offset.y * offset.y;
+        };
+        std::stable_sort(tileOrder.begin(), tileOrder.end(), [&](uint32_t a, uint32_t b) {
+            return distanceToCenter(a) < distanceToCenter(b);
+        });
+    }
+
+    return tileOrder;
+}
+
+
+void Raytracer::enqueueRenderRegion(const internal::Scene& scene, const internal::Camera& camera, const Config& config, glm::ivec2 origin, glm::ivec2 size, cl::Event* event, FrameOutput output) {
+    m_showDenoised = false;
+    if (!m_allowAccumulation) {
+        output = FrameOutput::Frame;
+    }
+    if (m_pipeline == Pipeline::Wavefront) {
+        enqueueRenderRegionWavefront(scene, camera, config, origin, size, event, output);
+        return;
+    }
+
+    // specialised kernels are only used if they were created up front for the config
+    auto specialised = m_kernels.find(config);
+    cl::Kernel raytracerKernel = specialised != m_kernels.end() ? specialised->second : m_genericKernel;
 
     raytracerKernel.setArg(0, sizeof(internal::Camera), &camera);
     raytracerKernel.setArg(1, sizeof(internal::SceneExtra), &scene.extra);
-    raytracerKernel.setArg(2, scene.objectsBuffer);
-    raytracerKernel.setArg(3, scene.materialsBuffer);
-    raytracerKernel.setArg(4, sizeof(uint32_t), &m_frameCount);
-    
-    if (m_clGlInterop && !m_allowAccumulation) {
-        raytracerKernel.setArg(5, m_frameImageGl);
+    raytracerKernel.setArg(2, scene.spheresBuffer);
+    raytracerKernel.setArg(3, scene.verticesBuffer);
+    raytracerKernel.setArg(4, scene.normalsBuffer);
+    raytracerKernel.setArg(5, scene.trianglesBuffer);
+    raytracerKernel.setArg(6, scene.materialsBuffer);
+    raytracerKernel.setArg(7, scene.bvhNodesBuffer);
+    raytracerKernel.setArg(8, scene.instancesBuffer);
+    raytracerKernel.setArg(9, scene.emittersBuffer);
+    // samples are numbered over every accumulated frame
+    uint32_t firstSampleIndex = (m_frameCount - 1) * config.sampleCount;
+    raytracerKernel.setArg(10, sizeof(uint32_t), &firstSampleIndex);
+    raytracerKernel.setArg(11, sizeof(uint32_t), &config.sampleCount);
+    raytracerKernel.setArg(12, sizeof(uint32_t), &config.bounceLimit);
+    raytracerKernel.setArg(13, sizeof(uint32_t), &config.rouletteDepth);
+    setRayCounterArg(raytracerKernel, 14);
+    setOptionalBufferArg(raytracerKernel, 15, m_albedoAovBuffer);
+    setOptionalBufferArg(raytracerKernel, 16, m_normalAovBuffer);
+    setOutputArgs(raytracerKernel, 17, output);
+
+    enqueueKernel("raytrace", raytracerKernel, cl::NDRange(origin.x, origin.y), cl::NDRange(size.x, size.y), event);
+}
+
+
+void Raytracer::enqueueRenderRegionWavefront(const internal::Scene& scene, const internal::Camera& camera, const Config& config, glm::ivec2 origin, glm::ivec2 size, cl::Event* event, FrameOutput output) {
+    WavefrontKernels& kernels = m_wavefrontKernels;
+    // paths are generated and written out per pixel of the region, everything else works on the queues
+    cl::NDRange regionOffset = cl::NDRange(origin.x, origin.y);
+    cl::NDRange regionSize = cl::NDRange(size.x, size.y);
+    cl::NDRange queueSize = cl::NDRange(size.x * size.y);
+
+    kernels.extendPaths.setArg(0, sizeof(internal::SceneExtra), &scene.extra);
+    kernels.extendPaths.setArg(1, scene.spheresBuffer);
+    kernels.extendPaths.setArg(2, scene.verticesBuffer);
+    kernels.extendPaths.setArg(3, scene.normalsBuffer);
+    kernels.extendPaths.setArg(4, scene.trianglesBuffer);
+    kernels.extendPaths.setArg(5, scene.bvhNodesBuffer);
+    kernels.extendPaths.setArg(6, scene.instancesBuffer);
+    kernels.extendPaths.setArg(9, m_hitsBuffer);
+    setRayCounterArg(kernels.extendPaths, 11);
+
+    // shading traces the shadow rays of light sampling, so it gets the whole scene
+    kernels.shadePaths.setArg(0, sizeof(internal::SceneExtra), &scene.extra);
+    kernels.shadePaths.setArg(1, scene.spheresBuffer);
+    kernels.shadePaths.setArg(2, scene.verticesBuffer);
+    kernels.shadePaths.setArg(3, scene.normalsBuffer);
+    kernels.shadePaths.setArg(4, scene.trianglesBuffer);
+    kernels.shadePaths.setArg(5, scene.bvhNodesBuffer);
+    kernels.shadePaths.setArg(6, scene.instancesBuffer);
+    kernels.shadePaths.setArg(7, scene.emittersBuffer);
+    kernels.shadePaths.setArg(8, scene.materialsBuffer);
+    kernels.shadePaths.setArg(11, m_hitsBuffer);
+    kernels.shadePaths.setArg(12, m_radianceBuffer);
+    kernels.shadePaths.setArg(13, sizeof(uint32_t), &config.bounceLimit);
+    kernels.shadePaths.setArg(14, sizeof(uint32_t), &config.rouletteDepth);
+    setOptionalBufferArg(kernels.shadePaths, 15, m_albedoAovBuffer);
+    setOptionalBufferArg(kernels.shadePaths, 16, m_normalAovBuffer);
+    setRayCounterArg(kernels.shadePaths, 17);
+
+    for (uint32_t sampleIdx = 0; sampleIdx < config.sampleCount; sampleIdx++) {
+        kernels.generatePaths.setArg(0, sizeof(internal::Camera), &camera);
+        kernels.generatePaths.setArg(1, m_pathBuffers[0]);
+        kernels.generatePaths.setArg(2, m_queueSizeBuffers[0]);
+        uint32_t globalSampleIdx = (m_frameCount - 1) * config.sampleCount + sampleIdx;
+        kernels.generatePaths.setArg(3, sizeof(uint32_t), &globalSampleIdx);
+        enqueueKernel("generatePaths", kernels.generatePaths, regionOffset, regionSize);
+
+        // the queues swap roles after every bounce
+        int current = 0;
+        for (uint32_t bounceIdx = 0; bounceIdx < config.bounceLimit; bounceIdx++) {
+            int next = 1 - current;
+
+            kernels.extendPaths.setArg(7, m_pathBuffers[current]);
+            kernels.extendPaths.setArg(8, m_queueSizeBuffers[current]);
+            kernels.extendPaths.setArg(10, m_queueSizeBuffers[next]);
+            enqueueKernel("extendPaths", kernels.extendPaths, cl::NullRange, queueSize);
+
+            kernels.shadePaths.setArg(9, m_pathBuffers[current]);
+            kernels.shadePaths.setArg(10, m_queueSizeBuffers[current]);
+            enqueueKernel("shadePaths", kernels.shadePaths, cl::NullRange, queueSize);
+
+            kernels.compactPaths.setArg(0, m_pathBuffers[current]);
+            kernels.compactPaths.setArg(1, m_queueSizeBuffers[current]);
+            kernels.compactPaths.setArg(2, m_pathBuffers[next]);
+            kernels.compactPaths.setArg(3, m_queueSizeBuffers[next]);
+            enqueueKernel("compactPaths", kernels.compactPaths, cl::NullRange, queueSize);
+
+            current = next;
+        }
+    }
+
+    kernels.writeRadiance.setArg(0, m_radianceBuffer);
+    kernels.writeRadiance.setArg(1, sizeof(uint32_t), &config.sampleCount);
+    kernels.writeRadiance.setArg(2, sizeof(uint32_t), &m_imageShape.x);
+    setOutputArgs(kernels.writeRadiance, 3, output);
+    enqueueKernel("writeRadiance", kernels.writeRadiance, regionOffset, regionSize, event);
+}
+
+
+// the previous and current running means, the frame count and the output image
+// with accumulation the kernel writes the mean into the accumulation image, otherwise the frame as is into the frame image
+// (and for adaptive sampling also into a float32 buffer)
+void Raytracer::setOutputArgs(cl::Kernel& kernel, uint32_t firstArgIndex, FrameOutput output) {
+    bool accumulate = output == FrameOutput::Accumulate;
+    if (accumulate) {
+        kernel.setArg(firstArgIndex + 0, m_accumBuffers[1 - m_accumBufferIdx]);
+        kernel.setArg(firstArgIndex + 1, m_accumBuffers[m_accumBufferIdx]);
+        kernel.setArg(firstArgIndex + 2, sizeof(uint32_t), &m_frameCount);
+    } else if (output == FrameOutput::AdaptiveRadiance) {
+        // the mean of a single frame is the frame itself, unclamped and in float32
+        uint32_t firstFrame = 1;
+        kernel.setArg(firstArgIndex + 0, sizeof(cl_mem), nullptr);
+        kernel.setArg(firstArgIndex + 1, m_accumBuffers[1 - m_accumBufferIdx]);
+        kernel.setArg(firstArgIndex + 2, sizeof(uint32_t), &firstFrame);
     } else {
-        raytracerKernel.setArg(5, m_frameImage);
+        kernel.setArg(firstArgIndex + 0, sizeof(cl_mem), nullptr);
+        kernel.setArg(firstArgIndex + 1, sizeof(cl_mem), nullptr);
+        kernel.setArg(firstArgIndex + 2, sizeof(uint32_t), &m_frameCount);
     }
 
-    m_clObjects.queue.enqueueNDRangeKernel(
-        raytracerKernel,
-        cl::NullRange,
-        cl::NDRange(m_imageShape.x * m_imageShape.y),
-        cl::NullRange
-    );
-    m_clObjects.queue.finish();
+    if (accumulate) {
+        if (m_clGlInterop) {
+            kernel.setArg(firstArgIndex + 3, m_accumImageGl);
+        } else {
+            kernel.setArg(firstArgIndex + 3, m_accumImage);
+        }
+    } else if (m_clGlInterop && !m_allowAccumulation) {
+        kernel.setArg(firstArgIndex + 3, m_frameImageGl);
+    } else {
+        kernel.setArg(firstArgIndex + 3, m_frameImage);
+    }
 }
 
 
-void Raytracer::readPixels(void* outBuffer) const {
-    if (m_allowAccumulation) {
-        m_clObjects.queue.enqueueReadImage(m_accumImage, true, {0, 0, 0}, {(size_t) m_imageShape.x, (size_t) m_imageShape.y, 1}, 0, 0, outBuffer);
+void Raytracer::setRayCounting(bool enable) {
+    if (!enable) {
+        m_rayCounterBuffer = cl::Buffer();
+        return;
+    }
+
+    if (m_rayCounterBuffer() == nullptr) {
+        m_rayCounterBuffer = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, sizeof(cl_uint) * 2);
+        resetRayCount();
+    }
+}
+
+
+uint64_t Raytracer::getRayCount() const {
+    if (m_rayCounterBuffer() == nullptr) {
+        return 0;
+    }
+
+    cl_uint counter[2];
+    cl::Event profilingEvent;
+    cl::Event* event = getProfilingEvent(nullptr, profilingEvent);
+    m_clObjects.queue.enqueueReadBuffer(m_rayCounterBuffer, true, 0, sizeof(counter), counter, nullptr, event);
+    recordCommand("read", event);
+    return ((uint64_t) counter[1] << 32) | counter[0];
+}
+
+
+void Raytracer::resetRayCount() {
+    if (m_rayCounterBuffer() == nullptr) {
+        return;
+    }
+
+    cl_uint counter[2] = {0, 0};
+    cl::Event profilingEvent;
+    cl::Event* event = getProfilingEvent(nullptr, profilingEvent);
+    m_clObjects.queue.enqueueWriteBuffer(m_rayCounterBuffer, true, 0, sizeof(counter), counter, nullptr, event);
+    recordCommand("write", event);
+}
+
+
+void Raytracer::setRayCounterArg(cl::Kernel& kernel, uint32_t argIndex) const {
+    setOptionalBufferArg(kernel, argIndex, m_rayCounterBuffer);
+}
+
+
+// null buffers are passed as null pointers, which the kernels check for
+void Raytracer::setOptionalBufferArg(cl::Kernel& kernel, uint32_t argIndex, const cl::Buffer& buffer) const {
+    if (buffer() == nullptr) {
+        kernel.setArg(argIndex, sizeof(cl_mem), nullptr);
     } else {
-        m_clObjects.queue.enqueueReadImage(m_frameImage, true, {0, 0, 0}, {(size_t) m_imageShape.x, (size_t) m_imageShape.y, 1}, 0, 0, outBuffer);
+        kernel.setArg(argIndex, buffer);
     }
 }
 
 
+void Raytracer::setAovOutput(bool enable) {
+    if (!enable) {
+        m_albedoAovBuffer = cl::Buffer();
+        m_normalAovBuffer = cl::Buffer();
+        return;
+    }
+
+    if (m_albedoAovBuffer() == nullptr) {
+        int err[2] = {0, 0};
+        size_t bufferSize = m_imageShape.x * m_imageShape.y * sizeof(cl_float4);
+        m_albedoAovBuffer = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, bufferSize, nullptr, &err[0]);
+        m_normalAovBuffer = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, bufferSize, nullptr, &err[1]);
+        if (err[0] || err[1]) {
+            printf("ERROR (`Raytracer::setAovOutput`): Unable to allocate %.3f MB for the aovs\n", (float) bufferSize * 2 / (1024 * 1024));
+            m_albedoAovBuffer = cl::Buffer();
+            m_normalAovBuffer = cl::Buffer();
+        }
+    }
+}
+
+
+void Raytracer::enqueueKernel(const char* name, const cl::Kernel& kernel, const cl::NDRange& offset, const cl::NDRange& globalSize, cl::Event* event) {
+    cl::Event profilingEvent;
+    cl::Event* kernelEvent = getProfilingEvent(event, profilingEvent);
+    m_clObjects.queue.enqueueNDRangeKernel(kernel, offset, globalSize, cl::NullRange, nullptr, kernelEvent);
+    recordCommand(name, kernelEvent);
+}
+
+
+// without a profiler, commands only get the event the caller asked for (if any)
+cl::Event* Raytracer::getProfilingEvent(cl::Event* event, cl::Event& storage) const {
+    return (event || !m_profiler) ? event : &storage;
+}
+
+
+void Raytracer::recordCommand(const char* name, cl::Event* event) const {
+    if (m_profiler) {
+        m_profiler->record(name, *event);
+    }
+}
+
+
+void Raytracer::setProfiler(Profiler* profiler) {
+    if (profiler && !m_clObjects.profilingEnabled) {
+        printf("ERROR (`Raytracer::setProfiler`): The command queue was created without profiling enabled\n");
+        return;
+    }
+    m_profiler = profiler;
+}
+
+
+bool Raytracer::getLastFrameStats(FrameStats& out) const {
+    if (!m_profiler) {
+        return false;
+    }
+    m_profiler->collect();
+    return m_profiler->getLastFrameStats(out);
+}
+
+
+const cl::Image2D& Raytracer::getOutputImage() const {
+    if (m_showDenoised) {
+        return m_denoisedImage;
+    }
+    return m_allowAccumulation ? m_accumImage : m_frameImage;
+}
+
+
+void Raytracer::readPixels(void* outBuffer) const {
+    cl::Event profilingEvent;
+    cl::Event* event = getProfilingEvent(nullptr, profilingEvent);
+    m_clObjects.queue.enqueueReadImage(getOutputImage(), true, {0, 0, 0}, {(size_t) m_imageShape.x, (size_t) m_imageShape.y, 1}, 0, 0, outBuffer, nullptr, event);
+    recordCommand("read", event);
+}
+
+
 bool Raytracer::saveAsImage(const char* filepath) const {
     if (m_format != Format::RGBA8) {
         printf("ERROR (`Raytracer::saveAsImage`): Cannot save image for Format::%d\n", m_format);
@@ -115,25 +563,187 @@ void Raytracer::accumulatePixels() {
         return;
     }
 
-    m_accumulatorKernel.setArg(0, m_frameImage);
-    m_accumulatorKernel.setArg(2, sizeof(uint32_t), &m_frameCount);
-    m_accumulatorKernel.setArg(3, sizeof(uint32_t), &m_imageShape.x);
+    advanceAccumulation();
+}
+
 
+// nothing to enqueue, the next frame reads the means the last one wrote
+void Raytracer::advanceAccumulation() {
+    m_accumBufferIdx = 1 - m_accumBufferIdx;
+    m_frameCount++;
+}
+
+
+bool Raytracer::denoise(const DenoiseSettings& settings) {
+    if (m_albedoAovBuffer() == nullptr) {
+        printf("ERROR (`Raytracer::denoise`): The aovs are disabled, see `setAovOutput`\n");
+        return false;
+    }
     if (m_clGlInterop) {
-        m_accumulatorKernel.setArg(1, m_accumImageGl);
-    } else {
-        m_accumulatorKernel.setArg(1, m_accumImage);
+        printf("ERROR (`Raytracer::denoise`): Not implemented with clgl interop\n");
+        return false;
+    }
+    if (m_denoiserKernel() == nullptr) {
+        createDenoiserKernel();
+        if (m_denoiserKernel() == nullptr) {
+            return false;
+        }
     }
 
-    m_clObjects.queue.enqueueNDRangeKernel(
-        m_accumulatorKernel,
-        cl::NullRange,
-        cl::NDRange(m_imageShape.x * m_imageShape.y),
-        cl::NullRange
-    );
+    m_denoiserKernel.setArg(2, m_albedoAovBuffer);
+    m_denoiserKernel.setArg(3, m_normalAovBuffer);
+    m_denoiserKernel.setArg(6, sizeof(float), &settings.normalPhi);
+    m_denoiserKernel.setArg(7, sizeof(float), &settings.albedoPhi);
+
+    // the first iteration reads the rendered image, the last one writes the output
+    const cl::Image2D* in = m_allowAccumulation ? &m_accumImage : &m_frameImage;
+    for (uint32_t i = 0; i < settings.iterations; i++) {
+        const cl::Image2D* out = i + 1 == settings.iterations ? &m_denoisedImage : &m_denoiseImages[i % 2];
+        int stepWidth = 1 << i;
+        float colorPhi = settings.colorPhi / (1 << i);
+
+        m_denoiserKernel.setArg(0, *in);
+        m_denoiserKernel.setArg(1, *out);
+        m_denoiserKernel.setArg(4, sizeof(int), &stepWidth);
+        m_denoiserKernel.setArg(5, sizeof(float), &colorPhi);
+        enqueueKernel("denoise", m_denoiserKernel, cl::NullRange, cl::NDRange(m_imageShape.x, m_imageShape.y));
+        in = out;
+    }
     m_clObjects.queue.finish();
 
-    m_frameCount++;
+    // without iterations the output is the rendered image itself
+    m_showDenoised = settings.iterations > 0;
+    return true;
+}
+
+
+void Raytracer::createDenoiserKernel() {
+    std::string denoiserFileSource = readFile("kernels/denoiser.cl");
+    if (denoiserFileSource.empty()) {
+        printf("ERROR (`createDenoiserKernel`): Something went wrong while reading the denoiser Cl file\n");
+        return;
+    }
+
+    cl::Program denoiserProgram;
+    if (!buildClProgram(m_clObjects, denoiserFileSource, makeClProgramsBuildFlags(), denoiserProgram)) {
+        printf("ERROR (`createDenoiserKernel`): Encountered error while building the denoiser Cl program\n");
+        printf("Build log for denoiser:\n%s\n", denoiserProgram.getBuildInfo<CL_PROGRAM_BUILD_LOG>(m_clObjects.device).c_str());
+        return;
+    }
+
+    int err[3] = {0, 0, 0};
+    cl::ImageFormat floatFormat = getClImageFormat(Format::RGBA32F);
+    m_denoiseImages[0] = cl::Image2D(m_clObjects.context, CL_MEM_READ_WRITE, floatFormat, m_imageShape.x, m_imageShape.y, 0, nullptr, &err[0]);
+    m_denoiseImages[1] = cl::Image2D(m_clObjects.context, CL_MEM_READ_WRITE, floatFormat, m_imageShape.x, m_imageShape.y, 0, nullptr, &err[1]);
+    m_denoisedImage = cl::Image2D(m_clObjects.context, CL_MEM_READ_WRITE, getClImageFormat(m_format), m_imageShape.x, m_imageShape.y, 0, nullptr, &err[2]);
+    if (err[0] || err[1] || err[2]) {
+        printf("ERROR (`createDenoiserKernel`): Unable to allocate the denoiser images\n");
+        return;
+    }
+
+    m_denoiserKernel = cl::Kernel(denoiserProgram, "atrousFilter");
+}
+
+
+FrameFence Raytracer::submitFrame(const internal::Scene& scene, const internal::Camera& camera, const Config& config) {
+    if (m_genericKernel() == nullptr) {
+        createClKernels();
+    }
+    if (m_profiler) {
+        m_profiler->beginFrame();
+    }
+
+    FrameFence fence;
+    enqueueRenderRegion(scene, camera, config, {0, 0}, m_imageShape, &fence.event);
+    if (m_allowAccumulation) {
+        advanceAccumulation();
+    }
+    m_clObjects.queue.flush();
+    return fence;
+}
+
+
+FrameFence Raytracer::submitRegion(const internal::Scene& scene, const internal::Camera& camera, const Config& config, glm::ivec2 origin, glm::ivec2 size) {
+    if (m_genericKernel() == nullptr) {
+        createClKernels();
+    }
+
+    if (m_profiler) {
+        m_profiler->beginFrame();
+    }
+
+    FrameFence fence;
+    enqueueRenderRegion(scene, camera, config, origin, size, &fence.event);
+    m_clObjects.queue.flush();
+    return fence;
+}
+
+
+FrameFence Raytracer::requestRegionReadback(glm::ivec2 origin, glm::ivec2 size, void* outBuffer, size_t rowPitch) {
+    FrameFence fence;
+    m_clObjects.queue.enqueueReadImage(
+        getOutputImage(), false,
+        {(size_t) origin.x, (size_t) origin.y, 0}, {(size_t) size.x, (size_t) size.y, 1},
+        rowPitch, 0, outBuffer, nullptr, &fence.event
+    );
+    recordCommand("read", &fence.event);
+    m_clObjects.queue.flush();
+    return fence;
+}
+
+
+bool Raytracer::requestReadback() {
+    PixelReadback& readback = m_readbacks[m_nextReadbackIdx];
+    if (readback.pending && !FrameFence{readback.event}.isComplete()) {
+        // both buffers are still being read into
+        return false;
+    }
+
+    readback.pixels.resize(getPixelBufferSize());
+    m_clObjects.queue.enqueueReadImage(getOutputImage(), false, {0, 0, 0}, {(size_t) m_imageShape.x, (size_t) m_imageShape.y, 1}, 0, 0, readback.pixels.data(), nullptr, &readback.event);
+    recordCommand("read", &readback.event);
+    m_clObjects.queue.flush();
+
+    readback.pending = true;
+    readback.sequence = ++m_readbackSequence;
+    m_nextReadbackIdx = 1 - m_nextReadbackIdx;
+    return true;
+}
+
+
+const uint8_t* Raytracer::getLatestPixels(uint64_t* sequence) {
+    PixelReadback* latest = nullptr;
+    for (PixelReadback& readback : m_readbacks) {
+        if (readback.pending && FrameFence{readback.event}.isComplete()) {
+            readback.pending = false;
+        }
+        if (!readback.pending && readback.sequence != 0 && (!latest || readback.sequence > latest->sequence)) {
+            latest = &readback;
+        }
+    }
+
+    if (!latest) {
+        return nullptr;
+    }
+    if (sequence) {
+        *sequence = latest->sequence;
+    }
+    return latest->pixels.data();
+}
+
+
+bool FrameFence::isComplete() const {
+    if (event() == nullptr) {
+        return true;
+    }
+    return event.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() <= CL_COMPLETE;
+}
+
+
+void FrameFence::wait() const {
+    if (event() != nullptr) {
+        event.wait();
+    }
 }
 
 
@@ -217,7 +827,67 @@ void Raytracer::createImageBuffers(uint32_t glTextureId) {
 }
 
 
-void Raytracer::createClKernels(const rt::Config& config) {
+void Raytracer::createWavefrontBuffers() {
+    int err[6] = {0, 0, 0, 0, 0, 0};
+    size_t numPixels = m_imageShape.x * m_imageShape.y;
+    float bufferSizeMB = (float) numPixels * (2 * PATH_STATE_SIZE + HIT_RECORD_SIZE + sizeof(cl_float4)) / (1024 * 1024);
+
+    m_pathBuffers[0] = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, numPixels * PATH_STATE_SIZE, nullptr, &err[0]);
+    m_pathBuffers[1] = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, numPixels * PATH_STATE_SIZE, nullptr, &err[1]);
+    m_queueSizeBuffers[0] = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, sizeof(cl_uint), nullptr, &err[2]);
+    m_queueSizeBuffers[1] = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, sizeof(cl_uint), nullptr, &err[3]);
+    m_hitsBuffer = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, numPixels * HIT_RECORD_SIZE, nullptr, &err[4]);
+    m_radianceBuffer = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, numPixels * sizeof(cl_float4), nullptr, &err[5]);
+
+    if (err[0] || err[1] || err[2] || err[3] || err[4] || err[5]) {
+        printf("ERROR (`createWavefrontBuffers`): Unable to allocate %.3f MB for the path queues\n", bufferSizeMB);
+        return;
+    }
+    printf("INFO (`createWavefrontBuffers`): Allocated %.3f MB for the path queues\n", bufferSizeMB);
+
+    cl_float4 zero = {0.0f, 0.0f, 0.0f, 0.0f};
+    m_clObjects.queue.enqueueFillBuffer(m_radianceBuffer, zero, 0, numPixels * sizeof(cl_float4));
+}
+
+
+void Raytracer::createAccumulationBuffers() {
+    int err[2] = {0, 0};
+    size_t bufferSize = m_imageShape.x * m_imageShape.y * sizeof(cl_float4);
+    m_accumBuffers[0] = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, bufferSize, nullptr, &err[0]);
+    m_accumBuffers[1] = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, bufferSize, nullptr, &err[1]);
+
+    float bufferSizeMB = (float) bufferSize * 2 / (1024 * 1024);
+    if (err[0] || err[1]) {
+        printf("ERROR (`createAccumulationBuffers`): Unable to allocate %.3f MB for the accumulation means\n", bufferSizeMB);
+    } else {
+        printf("INFO (`createAccumulationBuffers`): Allocated %.3f MB for the accumulation means\n", bufferSizeMB);
+    }
+}
+
+
+void Raytracer::createAdaptiveBuffers(uint32_t tileCount) {
+    if (m_pixelStatsBuffer() != nullptr && m_adaptiveTileCount == tileCount) {
+        return;
+    }
+
+    int err[2] = {0, 0};
+    size_t numPixels = m_imageShape.x * m_imageShape.y;
+    float bufferSizeMB = (float) (numPixels * sizeof(cl_float4) + tileCount * sizeof(cl_uint)) / (1024 * 1024);
+    if (m_pixelStatsBuffer() == nullptr) {
+        m_pixelStatsBuffer = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, numPixels * sizeof(cl_float4), nullptr, &err[0]);
+    }
+    m_activeTilesBuffer = cl::Buffer(m_clObjects.context, CL_MEM_READ_WRITE, tileCount * sizeof(cl_uint), nullptr, &err[1]);
+    m_adaptiveTileCount = tileCount;
+
+    if (err[0] || err[1]) {
+        printf("ERROR (`createAdaptiveBuffers`): Unable to allocate %.3f MB for the adaptive sampling stats\n", bufferSizeMB);
+        return;
+    }
+    printf("INFO (`createAdaptiveBuffers`): Allocated %.3f MB for the adaptive sampling stats\n", bufferSizeMB);
+}
+
+
+void Raytracer::createClKernels() {
     std::string raytracerFileSource = readFile("kernels/raytracer.cl");
     std::string accumulatorFileSource = readFile("kernels/accumulator.cl");
 
@@ -226,34 +896,129 @@ void Raytracer::createClKernels(const rt::Config& config) {
         return;
     }
 
-    cl::Program raytracerProgram = cl::Program(raytracerFileSource);
-    cl::Program accumulatorProgram = cl::Program(accumulatorFileSource);
-
-    std::string buildFlags = makeClProgramsBuildFlags(config);
+    std::string buildFlags = makeClProgramsBuildFlags();
     printf("INFO (`createClKernels`): (Re)building Cl Programs with flags: %s\n", buildFlags.c_str());
 
-    if (raytracerProgram.build(buildFlags.c_str()) || accumulatorProgram.build(buildFlags.c_str())) {
+    cl::Program raytracerProgram, accumulatorProgram;
+    bool raytracerFromCache, accumulatorFromCache;
+    bool raytracerBuilt = buildClProgram(m_clObjects, raytracerFileSource, buildFlags, raytracerProgram, &raytracerFromCache);
+    bool accumulatorBuilt = buildClProgram(m_clObjects, accumulatorFileSource, buildFlags, accumulatorProgram, &accumulatorFromCache);
+
+    if (!raytracerBuilt || !accumulatorBuilt) {
         printf("ERROR (`createClKernels`): Encountered error while building Cl programs\n");
         std::string raytracerBuildLog = raytracerProgram.getBuildInfo<CL_PROGRAM_BUILD_LOG>(m_clObjects.device);
         std::string accumulatorBuildLog = accumulatorProgram.getBuildInfo<CL_PROGRAM_BUILD_LOG>(m_clObjects.device);
         printf("Build log for raytracer:\n%s\n", raytracerBuildLog.c_str());
         printf("--------------------------\n");
         printf("Build log for accumulator:\n%s\n", accumulatorBuildLog.c_str());
-    } else {
-        printf("INFO (`createClKernels`): Built Cl programs successfully\n");
-        m_kernels[config] = cl::Kernel(raytracerProgram, "raytraceScene");
-        m_accumulatorKernel = cl::Kernel(accumulatorProgram, "accumulateFrameData");
+        return;
     }
+
+    m_kernelsFromCache = raytracerFromCache && accumulatorFromCache;
+    printf("INFO (`createClKernels`): Built Cl programs successfully%s\n", m_kernelsFromCache ? " (from cache)" : "");
+    m_genericKernel = cl::Kernel(raytracerProgram, "raytraceScene");
+    m_adaptiveAccumulatorKernel = cl::Kernel(accumulatorProgram, "accumulateAdaptive");
+    m_activeTilesKernel = cl::Kernel(accumulatorProgram, "updateActiveTiles");
+
+    if (m_pipeline != Pipeline::Wavefront) {
+        return;
+    }
+
+    std::string wavefrontFileSource = readFile("kernels/wavefront.cl");
+    if (wavefrontFileSource.empty()) {
+        printf("ERROR (`createClKernels`): Something went wrong while reading the wavefront Cl file\n");
+        return;
+    }
+
+    cl::Program wavefrontProgram;
+    bool wavefrontFromCache;
+    if (!buildClProgram(m_clObjects, wavefrontFileSource, buildFlags, wavefrontProgram, &wavefrontFromCache)) {
+        printf("ERROR (`createClKernels`): Encountered error while building the wavefront Cl program\n");
+        printf("Build log for wavefront:\n%s\n", wavefrontProgram.getBuildInfo<CL_PROGRAM_BUILD_LOG>(m_clObjects.device).c_str());
+        return;
+    }
+
+    m_kernelsFromCache = m_kernelsFromCache && wavefrontFromCache;
+    m_wavefrontKernels.generatePaths = cl::Kernel(wavefrontProgram, "generatePaths");
+    m_wavefrontKernels.extendPaths = cl::Kernel(wavefrontProgram, "extendPaths");
+    m_wavefrontKernels.shadePaths = cl::Kernel(wavefrontProgram, "shadePaths");
+    m_wavefrontKernels.compactPaths = cl::Kernel(wavefrontProgram, "compactPaths");
+    m_wavefrontKernels.writeRadiance = cl::Kernel(wavefrontProgram, "writeRadiance");
 }
 
 
-std::string Raytracer::makeClProgramsBuildFlags(const rt::Config& config) const {
+void Raytracer::setSampler(Sampler sampler) {
+    if (sampler == m_sampler) {
+        return;
+    }
+    m_sampler = sampler;
+
+    // kernels that weren't built yet get the new sampler when they are
+    if (m_genericKernel() == nullptr) {
+        return;
+    }
+    std::vector<Config> configs;
+    for (const auto& [config, kernel] : m_kernels) {
+        configs.push_back(config);
+    }
+    m_kernels.clear();
+    createClKernels();
+    for (const Config& config : configs) {
+        createClKernels(config);
+    }
+}
+
+
+void Raytracer::createClKernels(const rt::Config& config) {
+    bool genericFromCache = true;
+    if (m_genericKernel() == nullptr) {
+        createClKernels();
+        genericFromCache = m_kernelsFromCache;
+    }
+
+    std::string raytracerFileSource = readFile("kernels/raytracer.cl");
+    if (raytracerFileSource.empty()) {
+        printf("ERROR (`createClKernels`): Something went wrong while reading the Cl files\n");
+        return;
+    }
+
+    std::string buildFlags = makeClProgramsBuildFlags(config);
+    printf("INFO (`createClKernels`): Building specialised Cl program with flags: %s\n", buildFlags.c_str());
+
+    cl::Program raytracerProgram;
+    bool raytracerFromCache;
+    if (!buildClProgram(m_clObjects, raytracerFileSource, buildFlags, raytracerProgram, &raytracerFromCache)) {
+        printf("ERROR (`createClKernels`): Encountered error while building Cl programs\n");
+        printf("Build log for raytracer:\n%s\n", raytracerProgram.getBuildInfo<CL_PROGRAM_BUILD_LOG>(m_clObjects.device).c_str());
+        return;
+    }
+
+    m_kernelsFromCache = genericFromCache && raytracerFromCache;
+    printf("INFO (`createClKernels`): Built Cl programs successfully%s\n", m_kernelsFromCache ? " (from cache)" : "");
+    m_kernels[config] = cl::Kernel(raytracerProgram, "raytraceScene");
+}
+
+
+std::string Raytracer::makeClProgramsBuildFlags() const {
     std::stringstream stream;
 
     stream << " -cl-std=CL2.0";
+    if (m_sampler == Sampler::Random) {
+        stream << " -DCONFIG__SAMPLER_RANDOM";
+    }
+
+    return stream.str();
+}
+
+
+std::string Raytracer::makeClProgramsBuildFlags(const rt::Config& config) const {
+    std::stringstream stream;
+
+    stream << makeClProgramsBuildFlags();
 
     stream << " -DCONFIG__SAMPLE_COUNT=" << config.sampleCount;
     stream << " -DCONFIG__BOUNCE_LIMIT=" << config.bounceLimit;
+    stream << " -DCONFIG__ROULETTE_DEPTH=" << config.rouletteDepth;
 
     return stream.str();
 }
@@ -2,9 +2,12 @@
 #pragma once
 
 #include "src/clutils.h"
+#include "src/profiler.h"
 #include "src/raytracer/internal/camera.h"
 #include "src/raytracer/scene.h"
+#include <functional>
 #include <map>
+#include <tuple>
 #include <glm/vec2.hpp>
 
 
@@ -17,37 +20,217 @@ enum class Format {
 };
 
 
+enum class Pipeline {
+    Megakernel, // a single kernel runs every sample and bounce of a pixel
+    Wavefront   // separate generate/extend/shade/compact kernels over queues of paths
+};
+
+
+enum class Sampler {
+    Sobol, // Owen scrambled Sobol points, numbered by pixel, sample (over every accumulated frame) and dimension
+    Random // independent random numbers
+};
+
+
 struct Config {
     cl_uint sampleCount;
     cl_uint bounceLimit;
+    // bounces after which paths are ended at random by their throughput (russian roulette), none if >= `bounceLimit`
+    cl_uint rouletteDepth = 3;
 };
 
 static bool operator<(const Config& a, const Config& b) {
-    return (a.sampleCount < b.sampleCount) || (a.bounceLimit < b.bounceLimit);
+    return std::tie(a.sampleCount, a.bounceLimit, a.rouletteDepth) < std::tie(b.sampleCount, b.bounceLimit, b.rouletteDepth);
 }
 
 
+enum class TileOrder {
+    Scanline, // row by row, starting at the top left
+    CenterOut // nearest to the image center first
+};
+
+
+// State of a tiled render, reusing it after a cancelled render resumes from the remaining tiles
+// (as long as the raytracer hasn't rendered anything else in between)
+struct TiledRenderState {
+    glm::ivec2 tileSize = {256, 256};
+    TileOrder order = TileOrder::Scanline;
+
+    // indexed in scanline order
+    std::vector<bool> completedTiles;
+    uint32_t numCompletedTiles = 0;
+
+    bool isComplete() const { return !completedTiles.empty() && numCompletedTiles == completedTiles.size(); }
+    void reset() { completedTiles.clear(); numCompletedTiles = 0; }
+};
+
+
+struct TileProgress {
+    glm::ivec2 tileOrigin;
+    glm::ivec2 tileSize;
+    uint32_t numCompletedTiles;
+    uint32_t tileCount;
+};
+
+// called after every finished tile, returning false cancels the render
+using TileCallback = std::function<bool(const TileProgress&)>;
+
+
+// Settings of `Raytracer::renderSceneAdaptive`
+// the image is split into tiles, every frame only renders the tiles that haven't converged yet
+struct AdaptiveSampling {
+    glm::ivec2 tileSize = {32, 32};
+    // a tile converges once the standard error of every pixel's mean luminance is below this fraction of the mean
+    float noiseThreshold = 0.02f;
+    // frames rendered everywhere before the variance estimates are trusted
+    uint32_t minFrames = 8;
+    uint32_t maxFrames = 1024;
+    // in seconds, 0 for no limit
+    double timeBudget = 0.0;
+};
+
+
+struct AdaptiveSamplingStats {
+    uint32_t numFrames;
+    // frames times pixels rendered, each with `Config::sampleCount` samples
+    uint64_t numPixelFrames;
+    uint32_t numActiveTiles;
+    uint32_t tileCount;
+    double time;
+};
+
+
+// Settings of `Raytracer::denoise`, the edge stopping terms weigh down neighbours whose color/normal/albedo differ
+// (by the squared distance over phi), smaller values keep more edges
+struct DenoiseSettings {
+    // the filter footprint doubles with every iteration, 5 covers 125x125 pixels
+    uint32_t iterations = 5;
+    // halved with every iteration, so that later (wider) ones blur less across the remaining noise
+    float colorPhi = 0.5f;
+    float normalPhi = 0.05f;
+    float albedoPhi = 0.05f;
+};
+
+
+// Completion of the work enqueued by `Raytracer::submitFrame`
+struct FrameFence {
+    cl::Event event;
+
+    // negative execution statuses (errors) count as complete
+    bool isComplete() const;
+    void wait() const;
+};
+
+
+// host buffer for a non-blocking read of the output image
+struct PixelReadback {
+    std::vector<uint8_t> pixels;
+    cl::Event event;
+    bool pending = false;
+    uint64_t sequence = 0;
+};
+
+
+struct WavefrontKernels {
+    cl::Kernel generatePaths;
+    cl::Kernel extendPaths;
+    cl::Kernel shadePaths;
+    cl::Kernel compactPaths;
+    cl::Kernel writeRadiance;
+};
+
+
 class Raytracer {
 
     public:
-        Raytracer(glm::ivec2 imageShape, CL_Objects clObjects, Format format, bool allowAccumulation, uint32_t glTextureId = 0);
+        Raytracer(glm::ivec2 imageShape, CL_Objects clObjects, Format format, bool allowAccumulation, uint32_t glTextureId = 0, Pipeline pipeline = Pipeline::Megakernel);
         void renderScene(const internal::Scene& scene, const internal::Camera& camera, const Config& config);
+        // renders the image one tile (one dispatch) at a time, returns true once every tile is done
+        bool renderSceneTiled(const internal::Scene& scene, const internal::Camera& camera, const Config& config, TiledRenderState& state, const TileCallback& callback = nullptr);
+        // accumulates frames into a fresh image until every tile converges (see `AdaptiveSampling`), returns true if they all did
+        // needs accumulation, the result is read like an accumulated image
+        bool renderSceneAdaptive(const internal::Scene& scene, const internal::Camera& camera, const Config& config, const AdaptiveSampling& settings, AdaptiveSamplingStats* outStats = nullptr);
         void readPixels(void* outBuffer) const;
         bool saveAsImage(const char* filepath) const;
+        // adds the last rendered frame to the accumulation, the render kernels already wrote the new mean
         void accumulatePixels();
+        // filters the accumulated (or current) image with the edge avoiding a-trous wavelet filter
+        // needs the features of `setAovOutput`, the denoised image is what gets read until the next render or accumulation
+        bool denoise(const DenoiseSettings& settings = {});
+
+        // Asynchronous counterparts of renderScene + accumulatePixels and readPixels, nothing here waits on the device
+        // renders the frame (and accumulates it if allowed)
+        FrameFence submitFrame(const internal::Scene& scene, const internal::Camera& camera, const Config& config);
+        // starts reading the output image into one of two host buffers, returns false if both are still in use
+        bool requestReadback();
+        // pixels of the most recent finished readback (nullptr if there is none), `sequence` increases with every readback
+        const uint8_t* getLatestPixels(uint64_t* sequence = nullptr);
+        // renders only a region of the image, without waiting
+        FrameFence submitRegion(const internal::Scene& scene, const internal::Camera& camera, const Config& config, glm::ivec2 origin, glm::ivec2 size);
+        // starts reading a region of the output image into `outBuffer`, whose rows are `rowPitch` bytes apart
+        FrameFence requestRegionReadback(glm::ivec2 origin, glm::ivec2 size, void* outBuffer, size_t rowPitch);
+
         void resetFrameCount() { m_frameCount = 1; }
+        // counts every traced ray (on the device) until disabled
+        void setRayCounting(bool enable);
+        uint64_t getRayCount() const;
+        void resetRayCount();
+        // writes the albedo and normal of every pixel's first hit (for `denoise`) until disabled
+        void setAovOutput(bool enable);
+        // records the device timestamps of every enqueued command into `profiler` (nullptr disables it)
+        // needs a queue created with profiling enabled
+        void setProfiler(Profiler* profiler);
+        Profiler* getProfiler() const { return m_profiler; }
+        // stats of the most recent fully completed frame, false if profiling is disabled or none has completed
+        bool getLastFrameStats(FrameStats& out) const;
 
         const CL_Objects& getCl() const { return m_clObjects; }
         Format getPixelFormat() const { return m_format; }
+        Pipeline getPipeline() const { return m_pipeline; }
         bool allowsAccumulation() const { return m_allowAccumulation; }
         const glm::ivec2& getImageShape() const { return m_imageShape; }
         uint32_t getFrameCount() const { return m_frameCount; }
         uint32_t getPixelBufferSize() const;
+        // whether the last `createClKernels` call reused cached program binaries
+        bool areKernelsFromCache() const { return m_kernelsFromCache; }
+        // builds the kernels taking the sample count and bounce limit as arguments (done lazily by `renderScene`)
+        void createClKernels();
+        // builds a kernel specialised for `config`, used by `renderScene` instead of the generic one for that config
         void createClKernels(const rt::Config& config);
+        // rebuilds the kernels (the specialised ones too) if they were built with another sampler
+        void setSampler(Sampler sampler);
+        Sampler getSampler() const { return m_sampler; }
 
     private:
+        // what the render kernels write for a frame
+        enum class FrameOutput {
+            // the running mean, into the accumulation buffers and image (the frame image without accumulation)
+            Accumulate,
+            // the plain frame into `m_frameImage`, even if accumulation is allowed
+            Frame,
+            // the plain frame as float32 into the accumulation buffer `renderSceneAdaptive` doesn't keep its mean in
+            AdaptiveRadiance
+        };
+
         void createImageBuffers();
         void createImageBuffers(uint32_t glTextureId);
+        void createWavefrontBuffers();
+        void createAccumulationBuffers();
+        void advanceAccumulation();
+        void createAdaptiveBuffers(uint32_t tileCount);
+        void enqueueRenderRegion(const internal::Scene& scene, const internal::Camera& camera, const Config& config, glm::ivec2 origin, glm::ivec2 size, cl::Event* event, FrameOutput output = FrameOutput::Accumulate);
+        void enqueueRenderRegionWavefront(const internal::Scene& scene, const internal::Camera& camera, const Config& config, glm::ivec2 origin, glm::ivec2 size, cl::Event* event, FrameOutput output);
+        void setOutputArgs(cl::Kernel& kernel, uint32_t firstArgIndex, FrameOutput output);
+        std::vector<uint32_t> makeTileOrder(glm::ivec2 tileGrid, TileOrder order) const;
+        void setRayCounterArg(cl::Kernel& kernel, uint32_t argIndex) const;
+        void setOptionalBufferArg(cl::Kernel& kernel, uint32_t argIndex, const cl::Buffer& buffer) const;
+        void createDenoiserKernel();
+        // the image read back by `readPixels` and the readbacks
+        const cl::Image2D& getOutputImage() const;
+        void enqueueKernel(const char* name, const cl::Kernel& kernel, const cl::NDRange& offset, const cl::NDRange& globalSize, cl::Event* event = nullptr);
+        cl::Event* getProfilingEvent(cl::Event* event, cl::Event& storage) const;
+        void recordCommand(const char* name, cl::Event* event) const;
+        std::string makeClProgramsBuildFlags() const;
         std::string makeClProgramsBuildFlags(const rt::Config& config) const;
 
     private:
@@ -56,13 +239,51 @@ class Raytracer {
         Format m_format;
         bool m_allowAccumulation;
         bool m_clGlInterop;
+        Pipeline m_pipeline;
+        Sampler m_sampler = Sampler::Sobol;
         uint32_t m_frameCount = 1;
+        bool m_kernelsFromCache = false;
 
+        cl::Kernel m_genericKernel;
         std::map<Config, cl::Kernel> m_kernels;
-        cl::Kernel m_accumulatorKernel;
+        cl::Kernel m_adaptiveAccumulatorKernel;
+        cl::Kernel m_activeTilesKernel;
+        WavefrontKernels m_wavefrontKernels;
+
+        // path queues (current and next) and their sizes, only for Pipeline::Wavefront
+        cl::Buffer m_pathBuffers[2];
+        cl::Buffer m_queueSizeBuffers[2];
+        cl::Buffer m_hitsBuffer;
+        cl::Buffer m_radianceBuffer;
+
+        // per pixel luminance stats and per tile activity, only for `renderSceneAdaptive`
+        cl::Buffer m_pixelStatsBuffer;
+        cl::Buffer m_activeTilesBuffer;
+        uint32_t m_adaptiveTileCount = 0;
+
+        PixelReadback m_readbacks[2];
+        int m_nextReadbackIdx = 0;
+        uint64_t m_readbackSequence = 0;
+
+        // null if ray counting is disabled
+        cl::Buffer m_rayCounterBuffer;
+        // null if the aovs are disabled
+        cl::Buffer m_albedoAovBuffer;
+        cl::Buffer m_normalAovBuffer;
+        // null if profiling is disabled
+        Profiler* m_profiler = nullptr;
 
         cl::Image2D m_frameImage;
         cl::Image2D m_accumImage;
+        // float32 running means of the accumulated frames, the render kernels read one and write the other
+        cl::Buffer m_accumBuffers[2];
+        int m_accumBufferIdx = 0;
+
+        // float images the filter iterations alternate between, and the result in the output format
+        cl::Kernel m_denoiserKernel;
+        cl::Image2D m_denoiseImages[2];
+        cl::Image2D m_denoisedImage;
+        bool m_showDenoised = false;
 
         // one of them will be used if clgl interop is present
         cl::ImageGL m_frameImageGl;
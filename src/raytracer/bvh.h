@@ -0,0 +1,279 @@
+
+#pragma once
+
+#include "src/raytracer/internal/bvh.h"
+#include "src/raytracer/internal/objects.h"
+#include <glm/glm.hpp>
+#include <algorithm>
+#include <cfloat>
+#include <cstdio>
+#include <vector>
+
+#define RT_BVH_BIN_COUNT 16
+#define RT_BVH_MAX_LEAF_SIZE 8
+// cost of a node traversal relative to an object intersection
+#define RT_BVH_TRAVERSAL_COST 1.0f
+// max depth of the stack used to walk a bvh, must match BVH_STACK_SIZE in kernels/bvh.h
+#define RT_BVH_STACK_SIZE 64
+// deeper nodes are kept as leaves, so that walking the tree never needs more than RT_BVH_STACK_SIZE entries
+#define RT_BVH_MAX_DEPTH (RT_BVH_STACK_SIZE - 1)
+
+
+namespace rt {
+
+struct Aabb {
+    glm::vec3 min = glm::vec3(FLT_MAX);
+    glm::vec3 max = glm::vec3(-FLT_MAX);
+
+    void grow(const glm::vec3& point) {
+        min = glm::min(min, point);
+        max = glm::max(max, point);
+    }
+
+    void grow(const Aabb& other) {
+        min = glm::min(min, other.min);
+        max = glm::max(max, other.max);
+    }
+
+    float area() const {
+        glm::vec3 e = max - min;
+        return (e.x < 0.0f) ? 0.0f : 2.0f * (e.x * e.y + e.y * e.z + e.z * e.x);
+    }
+};
+
+
+static glm::vec3 toVec3(const cl_float3& v) {
+    return {v.s[0], v.s[1], v.s[2]};
+}
+
+
+static Aabb getBounds(const internal::Sphere& sphere) {
+    Aabb out;
+    glm::vec3 position = toVec3(sphere.position);
+    out.grow(position - glm::vec3(sphere.radius));
+    out.grow(position + glm::vec3(sphere.radius));
+    return out;
+}
+
+
+static Aabb getBounds(const internal::Triangle& triangle) {
+    Aabb out;
+    out.grow(toVec3(triangle.v0));
+    out.grow(toVec3(triangle.v1));
+    out.grow(toVec3(triangle.v2));
+    return out;
+}
+
+
+namespace internal {
+
+struct BvhBuilder {
+    std::vector<Aabb> bounds;
+    std::vector<glm::vec3> centroids;
+    std::vector<uint32_t> indices;
+    std::vector<BvhNode> nodes;
+    // number of nodes that would have been split further, but were past RT_BVH_MAX_DEPTH
+    uint32_t depthLimitedLeaves = 0;
+
+    void setNodeBounds(BvhNode& node) {
+        Aabb box;
+        for (uint32_t i = 0; i < node.count; i++) {
+            box.grow(bounds[indices[node.leftFirst + i]]);
+        }
+        node.boundsMin = {box.min.x, box.min.y, box.min.z, 0.0f};
+        node.boundsMax = {box.max.x, box.max.y, box.max.z, 0.0f};
+    }
+
+    // binned SAH, returns the cost of the best split (FLT_MAX if none)
+    float findBestSplit(const BvhNode& node, int& bestAxis, float& bestPos) {
+        Aabb centroidBounds;
+        for (uint32_t i = 0; i < node.count; i++) {
+            centroidBounds.grow(centroids[indices[node.leftFirst + i]]);
+        }
+
+        float bestCost = FLT_MAX;
+        for (int axis = 0; axis < 3; axis++) {
+            float boundsMin = centroidBounds.min[axis];
+            float boundsMax = centroidBounds.max[axis];
+            if (boundsMin == boundsMax) {
+                continue;
+            }
+
+            Aabb binBounds[RT_BVH_BIN_COUNT];
+            uint32_t binCounts[RT_BVH_BIN_COUNT] = {};
+            float scale = RT_BVH_BIN_COUNT / (boundsMax - boundsMin);
+            for (uint32_t i = 0; i < node.count; i++) {
+                uint32_t objIdx = indices[node.leftFirst + i];
+                int binIdx = std::min(RT_BVH_BIN_COUNT - 1, (int) ((centroids[objIdx][axis] - boundsMin) * scale));
+                binCounts[binIdx]++;
+                binBounds[binIdx].grow(bounds[objIdx]);
+            }
+
+            // sweeping from both sides to get the area and count on either side of every plane
+            float leftArea[RT_BVH_BIN_COUNT - 1], rightArea[RT_BVH_BIN_COUNT - 1];
+            uint32_t leftCount[RT_BVH_BIN_COUNT - 1], rightCount[RT_BVH_BIN_COUNT - 1];
+            Aabb leftBox, rightBox;
+            uint32_t leftSum = 0, rightSum = 0;
+            for (int i = 0; i < RT_BVH_BIN_COUNT - 1; i++) {
+                leftSum += binCounts[i];
+                leftCount[i] = leftSum;
+                leftBox.grow(binBounds[i]);
+                leftArea[i] = leftBox.area();
+
+                rightSum += binCounts[RT_BVH_BIN_COUNT - 1 - i];
+                rightCount[RT_BVH_BIN_COUNT - 2 - i] = rightSum;
+                rightBox.grow(binBounds[RT_BVH_BIN_COUNT - 1 - i]);
+                rightArea[RT_BVH_BIN_COUNT - 2 - i] = rightBox.area();
+            }
+
+            float binWidth = (boundsMax - boundsMin) / RT_BVH_BIN_COUNT;
+            for (int i = 0; i < RT_BVH_BIN_COUNT - 1; i++) {
+                float cost = leftCount[i] * leftArea[i] + rightCount[i] * rightArea[i];
+                if (cost < bestCost && leftCount[i] > 0 && rightCount[i] > 0) {
+                    bestCost = cost;
+                    bestAxis = axis;
+                    bestPos = boundsMin + binWidth * (i + 1);
+                }
+            }
+        }
+
+        return bestCost;
+    }
+
+    void subdivide(uint32_t nodeIdx, uint32_t depth) {
+        BvhNode& node = nodes[nodeIdx];
+        if (node.count <= 1) {
+            return;
+        }
+        if (depth >= RT_BVH_MAX_DEPTH) {
+            depthLimitedLeaves++;
+            return;
+        }
+
+        int axis = -1;
+        float splitPos = 0.0f;
+        float splitCost = findBestSplit(node, axis, splitPos);
+        if (axis == -1) {
+            // all centroids are at the same point
+            return;
+        }
+
+        Aabb nodeBounds = {toVec3(node.boundsMin), toVec3(node.boundsMax)};
+        float leafCost = node.count * nodeBounds.area();
+        splitCost += RT_BVH_TRAVERSAL_COST * nodeBounds.area();
+        if (splitCost >= leafCost && node.count <= RT_BVH_MAX_LEAF_SIZE) {
+            return;
+        }
+
+        auto first = indices.begin() + node.leftFirst;
+        auto middle = std::partition(first, first + node.count, [&](uint32_t objIdx) {
+            return centroids[objIdx][axis] < splitPos;
+        });
+        uint32_t leftCount = middle - first;
+        if (leftCount == 0 || leftCount == node.count) {
+            return;
+        }
+
+        uint32_t leftChildIdx = nodes.size();
+        BvhNode leftChild = {}, rightChild = {};
+        leftChild.leftFirst = node.leftFirst;
+        leftChild.count = leftCount;
+        rightChild.leftFirst = node.leftFirst + leftCount;
+        rightChild.count = node.count - leftCount;
+        setNodeBounds(leftChild);
+        setNodeBounds(rightChild);
+
+        // `node` is invalidated by the push_back's
+        nodes[nodeIdx].leftFirst = leftChildIdx;
+        nodes[nodeIdx].count = 0;
+        nodes.push_back(leftChild);
+        nodes.push_back(rightChild);
+
+        subdivide(leftChildIdx, depth + 1);
+        subdivide(leftChildIdx + 1, depth + 1);
+    }
+};
+
+}
+
+
+// Builds a bvh over primitives with the given bounds
+// `outIndices` is the order in which the primitives have to be stored for the leaves to index them
+static std::vector<internal::BvhNode> buildBvh(const std::vector<Aabb>& primitiveBounds, std::vector<uint32_t>& outIndices) {
+    internal::BvhBuilder builder;
+    outIndices.clear();
+    if (primitiveBounds.empty()) {
+        return {};
+    }
+
+    builder.bounds = primitiveBounds;
+    builder.centroids.resize(primitiveBounds.size());
+    builder.indices.resize(primitiveBounds.size());
+    for (uint32_t i = 0; i < primitiveBounds.size(); i++) {
+        builder.centroids[i] = (builder.bounds[i].min + builder.bounds[i].max) * 0.5f;
+        builder.indices[i] = i;
+    }
+
+    builder.nodes.reserve(primitiveBounds.size() * 2 - 1);
+    internal::BvhNode root = {};
+    root.leftFirst = 0;
+    root.count = primitiveBounds.size();
+    builder.setNodeBounds(root);
+    builder.nodes.push_back(root);
+    builder.subdivide(0, 0);
+    if (builder.depthLimitedLeaves > 0) {
+        printf(
+            "WARN (`rt::buildBvh`): The bvh reached its max depth (%d), %u nodes were kept as leaves without splitting them\n",
+            RT_BVH_MAX_DEPTH, builder.depthLimitedLeaves
+        );
+    }
+
+    outIndices = std::move(builder.indices);
+    return builder.nodes;
+}
+
+
+// Appends `nodes` to `allNodes`, returns the index of its root
+static uint32_t appendBvh(std::vector<internal::BvhNode>& allNodes, const std::vector<internal::BvhNode>& nodes) {
+    uint32_t offset = allNodes.size();
+    for (internal::BvhNode node : nodes) {
+        if (node.count == 0) {
+            node.leftFirst += offset;
+        }
+        allNodes.push_back(node);
+    }
+    return offset;
+}
+
+
+// SAH cost of the tree at `root` (the expected cost of a ray that hits the root)
+// refitting keeps the topology but lets nodes overlap, so the cost of a refit tree grows compared to a fresh build
+static float getBvhCost(const std::vector<internal::BvhNode>& nodes, uint32_t root) {
+    if (root >= nodes.size()) {
+        return 0.0f;
+    }
+    float rootArea = Aabb{toVec3(nodes[root].boundsMin), toVec3(nodes[root].boundsMax)}.area();
+    if (rootArea == 0.0f) {
+        return 0.0f;
+    }
+
+    float cost = 0.0f;
+    uint32_t stack[RT_BVH_STACK_SIZE];
+    int stackSize = 0;
+    stack[stackSize++] = root;
+    while (stackSize > 0) {
+        const internal::BvhNode& node = nodes[stack[--stackSize]];
+        float area = Aabb{toVec3(node.boundsMin), toVec3(node.boundsMax)}.area();
+        if (node.count > 0) {
+            cost += area * node.count;
+        } else {
+            // `buildBvh` limits the depth, so the stack can't overflow
+            cost += area * RT_BVH_TRAVERSAL_COST;
+            stack[stackSize++] = node.leftFirst;
+            stack[stackSize++] = node.leftFirst + 1;
+        }
+    }
+    return cost / rootArea;
+}
+
+}
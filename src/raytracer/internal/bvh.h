@@ -0,0 +1,18 @@
+
+#pragma once
+
+#include <CL/opencl.hpp>
+
+
+namespace rt::internal {
+
+// if count == 0, leftFirst is the index of the left child (right child is leftFirst + 1)
+// otherwise it is the index of the first object of the leaf
+struct BvhNode {
+    cl_float3 boundsMin;
+    cl_float3 boundsMax;
+    cl_uint leftFirst;
+    cl_uint count;
+};
+
+}
@@ -9,6 +9,7 @@ namespace rt::internal {
 struct Sphere {
     cl_float3 position;
     cl_float radius;
+    cl_uint materialIndex;
 };
 
 
@@ -19,13 +20,38 @@ struct Triangle {
 };
 
 
-struct Object {
-    union {
-        Sphere sphere;
-        Triangle triangle;
-    };
-    cl_uint type;
+// a triangle of the scene's vertex buffer
+struct TriangleIndices {
+    cl_uint v0;
+    cl_uint v1;
+    cl_uint v2;
+    cl_uint materialIndex;
+};
+
+
+// materialIndex of an instance that keeps the materials of its mesh
+#define RT_INSTANCE_MESH_MATERIAL 0xFFFFFFFF
+
+// a mesh placed in the scene, traced through its own bvh
+struct Instance {
+    // rows of the affine world to object transform
+    cl_float4 worldToObject[3];
+    cl_uint bvhRoot;
     cl_uint materialIndex;
 };
 
+
+// a primitive with an emissive material, in world space
+struct Emitter {
+    // first vertex of a triangle, or center of a sphere
+    cl_float3 v0;
+    // edges v0v1 and v0v2 of a triangle, or (radius, 0, 0) and zero for a sphere
+    cl_float3 edge1;
+    cl_float3 edge2;
+    cl_float3 emission;
+    // sum of the power of the emitters up to this one, over the total power
+    cl_float cdf;
+    cl_uint isSphere;
+};
+
 }
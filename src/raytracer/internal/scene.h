@@ -9,13 +9,31 @@ namespace rt::internal {
 // temp thing
 struct SceneExtra {
     cl_float3 backgroundColor;
-    cl_uint numObjects;
+    cl_uint numSpheres;
+    cl_uint numTriangles;
+    cl_uint numBvhNodes;
+    // the sphere bvh starts at node 0, the triangle bvh follows it
+    cl_uint triangleBvhRoot;
+    cl_uint numInstances;
+    // top level bvh over the instances, after the bvh of every instanced mesh
+    cl_uint instanceBvhRoot;
+    cl_uint numEmitters;
+    // one over the total emitted power, zero without emitters
+    cl_float emitterPdfScale;
 };
 
 
+// one buffer per primitive type, buffers of types the scene doesn't have are null
 struct Scene {
-    cl::Buffer objectsBuffer;
+    cl::Buffer spheresBuffer;
+    cl::Buffer verticesBuffer;
+    // per vertex, null if no mesh has normals
+    cl::Buffer normalsBuffer;
+    cl::Buffer trianglesBuffer;
     cl::Buffer materialsBuffer;
+    cl::Buffer bvhNodesBuffer;
+    cl::Buffer instancesBuffer;
+    cl::Buffer emittersBuffer;
     SceneExtra extra;
 };
 
@@ -0,0 +1,74 @@
+
+#pragma once
+
+#include "src/raytracer/internal/material.h"
+#include <glm/glm.hpp>
+#include <memory>
+#include <vector>
+
+
+namespace rt {
+
+// Indexed triangle mesh, its vertices are shared by every triangle that uses them
+struct Mesh {
+    std::vector<glm::vec3> vertices;
+    // 3 per triangle
+    std::vector<uint32_t> indices;
+    // one per vertex, or empty for flat shading
+    std::vector<glm::vec3> normals;
+    std::shared_ptr<internal::Material> material;
+};
+
+
+// A copy of a scene mesh with its own transform, the mesh's geometry is stored once however many instances use it
+// meshes used by an instance are only drawn through their instances
+struct MeshInstance {
+    // index in `Scene::meshes`
+    uint32_t meshIndex;
+    // object to world
+    glm::mat4 transform;
+    // null to keep the mesh's material
+    std::shared_ptr<internal::Material> material;
+};
+
+
+static Mesh createMesh(std::vector<glm::vec3> vertices, std::vector<uint32_t> indices, std::shared_ptr<internal::Material> material, std::vector<glm::vec3> normals = {}) {
+    Mesh mesh = {
+        .vertices = std::move(vertices),
+        .indices = std::move(indices),
+        .normals = std::move(normals),
+        .material = material
+    };
+    return mesh;
+}
+
+
+static MeshInstance createMeshInstance(uint32_t meshIndex, const glm::mat4& transform, std::shared_ptr<internal::Material> material = nullptr) {
+    MeshInstance instance = {
+        .meshIndex = meshIndex,
+        .transform = transform,
+        .material = material
+    };
+    return instance;
+}
+
+
+static bool isValid(const Mesh& mesh) {
+    if (mesh.indices.size() % 3 != 0) {
+        printf("ERROR (`rt::isValid`): Mesh index count (%d) is not a multiple of 3\n", (int) mesh.indices.size());
+        return false;
+    }
+    if (!mesh.normals.empty() && mesh.normals.size() != mesh.vertices.size()) {
+        printf("ERROR (`rt::isValid`): Mesh has %d normals for %d vertices\n", (int) mesh.normals.size(), (int) mesh.vertices.size());
+        return false;
+    }
+    for (uint32_t index : mesh.indices) {
+        if (index >= mesh.vertices.size()) {
+            printf("ERROR (`rt::isValid`): Mesh index %u is out of range (%d vertices)\n", index, (int) mesh.vertices.size());
+            return false;
+        }
+    }
+    return true;
+}
+
+}
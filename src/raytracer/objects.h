@@ -19,7 +19,8 @@ struct Object {
 static Object createSphere(const glm::vec3& position, float radius, std::shared_ptr<internal::Material> material) {
     internal::Sphere sphere = {
         .position = {position.x, position.y, position.z, 1.0f},
-        .radius = radius
+        .radius = radius,
+        .materialIndex = 0
     };
     Object object = {
         .internal = sphere,
@@ -42,19 +43,4 @@ static Object createTriangle(const glm::vec3& v0, const glm::vec3& v1, const glm
     return object;
 }
 
-
-static internal::Object convert(const Object& object) {
-    internal::Object out;
-    if (auto ptr = std::get_if<internal::Sphere>(&object.internal)) {
-        out.sphere = *ptr;
-        out.type = 0;
-    } else if (auto ptr = std::get_if<internal::Triangle>(&object.internal)) {
-        out.triangle = *ptr;
-        out.type = 1;
-    } else {
-        printf("ERROR: While convert rt::Object to rt::internal::Object\n");
-    }
-    return out;
-}
-
 }
@@ -0,0 +1,33 @@
+
+#pragma once
+
+#include <algorithm>
+#include <thread>
+#include <vector>
+
+// loops with fewer items per thread than this run on fewer threads (down to just the calling one)
+#define RT_PARALLEL_MIN_ITEMS_PER_THREAD 16384
+
+
+namespace rt {
+
+// Calls `func(first, last)` over disjoint ranges that cover [0, `count`), each on its own thread
+template <typename Func>
+static void parallelFor(size_t count, const Func& func) {
+    size_t numThreads = std::min<size_t>(std::max(1u, std::thread::hardware_concurrency()), count / RT_PARALLEL_MIN_ITEMS_PER_THREAD);
+    if (numThreads <= 1) {
+        func((size_t) 0, count);
+        return;
+    }
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < numThreads; i++) {
+        threads.emplace_back(func, count * i / numThreads, count * (i + 1) / numThreads);
+    }
+    func((size_t) 0, count / numThreads);
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+}
+
+}
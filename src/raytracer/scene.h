@@ -3,76 +3,604 @@
 
 #include "src/raytracer/internal/scene.h"
 #include "src/raytracer/objects.h"
+#include "src/raytracer/mesh.h"
 #include "src/raytracer/material.h"
+#include "src/raytracer/bvh.h"
+#include "src/raytracer/parallel.h"
+#include <glm/gtc/constants.hpp>
+#include <cstring>
+#include <unordered_map>
 #include <vector>
 
+// entries of the pointer cache used when grouping materials
+#define RT_MATERIAL_CACHE_SIZE 256
+
 
 namespace rt {
 
 struct Scene {
     std::vector<Object> objects;
+    std::vector<Mesh> meshes;
+    std::vector<MeshInstance> instances;
     glm::vec3 backgroundColor;
 };
 
 
-static internal::Scene convert(const Scene& scene, cl::Context clContext, cl::CommandQueue clQueue) {
+// Triangles of a mesh drawn through instances, and the root of its bvh (in object space)
+struct InstancedMesh {
+    uint32_t firstTriangle;
+    uint32_t numTriangles;
+    uint32_t bvhRoot;
+};
+
+
+// Host side copy of the arrays uploaded by `convert`
+struct SceneData {
+    std::vector<internal::Sphere> spheres;
+    std::vector<cl_float3> vertices;
+    // per vertex, empty if no mesh has normals
+    std::vector<cl_float3> normals;
+    std::vector<internal::TriangleIndices> triangles;
+    // triangles past this one belong to `instancedMeshes`
+    uint32_t numSceneTriangles = 0;
+    std::vector<InstancedMesh> instancedMeshes;
+    std::vector<internal::Material> materials;
+    // index in `materials` of every material pointer used by the scene, only filled if it is editable
+    std::unordered_map<std::shared_ptr<internal::Material>, uint32_t> materialIndices;
+    std::vector<internal::BvhNode> bvhNodes;
+    uint32_t triangleBvhRoot = 0;
+    // the bvh of every instanced mesh starts here, the instance bvh comes last
+    uint32_t firstInstanceNode = 0;
+    std::vector<internal::Instance> instances;
+    // per instance, its index in `instancedMeshes` and its object to world transform
+    std::vector<uint32_t> instanceMeshes;
+    std::vector<glm::mat4> instanceTransforms;
+    uint32_t instanceBvhRoot = 0;
+    // index of every scene object in `spheres` or `triangles` (after the bvh reordering)
+    std::vector<uint32_t> objectSlots;
+    // every emissive primitive, sampled by the kernel for direct light
+    std::vector<internal::Emitter> emitters;
+    float emitterPower = 0.0f;
+    glm::vec3 backgroundColor;
+};
+
+
+static Aabb getBounds(const internal::TriangleIndices& triangle, const std::vector<cl_float3>& vertices) {
+    Aabb out;
+    out.grow(toVec3(vertices[triangle.v0]));
+    out.grow(toVec3(vertices[triangle.v1]));
+    out.grow(toVec3(vertices[triangle.v2]));
+    return out;
+}
+
+
+// Builds a bvh over the triangles in [`first`, `first + count`) and reorders them for its leaves
+// the leaves index `triangles` directly, `outSlots` (if given) is relative to `first`
+static std::vector<internal::BvhNode> buildTriangleBvh(SceneData& data, uint32_t first, uint32_t count, std::vector<uint32_t>* outSlots = nullptr) {
+    std::vector<Aabb> bounds(count);
+    for (uint32_t i = 0; i < count; i++) {
+        bounds[i] = getBounds(data.triangles[first + i], data.vertices);
+    }
+
+    std::vector<uint32_t> order;
+    std::vector<internal::BvhNode> nodes = rt::buildBvh(bounds, order);
+    std::vector<internal::TriangleIndices> orderedTriangles(count);
+    for (uint32_t i = 0; i < order.size(); i++) {
+        orderedTriangles[i] = data.triangles[first + order[i]];
+    }
+    std::copy(orderedTriangles.begin(), orderedTriangles.end(), data.triangles.begin() + first);
+    if (outSlots) {
+        outSlots->resize(count);
+        for (uint32_t i = 0; i < order.size(); i++) {
+            (*outSlots)[order[i]] = i;
+        }
+    }
+
+    for (internal::BvhNode& node : nodes) {
+        if (node.count > 0) {
+            node.leftFirst += first;
+        }
+    }
+    return nodes;
+}
+
+
+// World bounds of an instance, from the 8 corners of its mesh's bvh root
+static Aabb getInstanceBounds(const SceneData& data, uint32_t instanceIdx) {
+    const internal::BvhNode& root = data.bvhNodes[data.instancedMeshes[data.instanceMeshes[instanceIdx]].bvhRoot];
+    const glm::mat4& transform = data.instanceTransforms[instanceIdx];
+    glm::vec3 min = toVec3(root.boundsMin), max = toVec3(root.boundsMax);
+
+    Aabb out;
+    for (int corner = 0; corner < 8; corner++) {
+        glm::vec3 p = {corner & 1 ? max.x : min.x, corner & 2 ? max.y : min.y, corner & 4 ? max.z : min.z};
+        out.grow(glm::vec3(transform * glm::vec4(p, 1.0f)));
+    }
+    return out;
+}
+
+
+// Builds a bvh over the spheres and one over the scene triangles (stored after it), and reorders both for their leaves
+// `outSphereSlots[i]`/`outTriangleSlots[i]` is the new index of the primitive that was at `i`
+// then builds a bvh per instanced mesh and the top level bvh over the instances, in that order
+static void buildSceneBvh(SceneData& data, std::vector<uint32_t>& outSphereSlots, std::vector<uint32_t>& outTriangleSlots) {
+    std::vector<Aabb> sphereBounds(data.spheres.size());
+    for (int i = 0; i < data.spheres.size(); i++) {
+        sphereBounds[i] = getBounds(data.spheres[i]);
+    }
+
+    std::vector<uint32_t> order;
+    data.bvhNodes = rt::buildBvh(sphereBounds, order);
+    std::vector<internal::Sphere> orderedSpheres(data.spheres.size());
+    outSphereSlots.resize(data.spheres.size());
+    for (int i = 0; i < order.size(); i++) {
+        orderedSpheres[i] = data.spheres[order[i]];
+        outSphereSlots[order[i]] = i;
+    }
+    data.spheres = std::move(orderedSpheres);
+
+    std::vector<internal::BvhNode> triangleBvhNodes = buildTriangleBvh(data, 0, data.numSceneTriangles, &outTriangleSlots);
+    data.triangleBvhRoot = appendBvh(data.bvhNodes, triangleBvhNodes);
+    data.firstInstanceNode = data.bvhNodes.size();
+
+    for (InstancedMesh& mesh : data.instancedMeshes) {
+        mesh.bvhRoot = appendBvh(data.bvhNodes, buildTriangleBvh(data, mesh.firstTriangle, mesh.numTriangles));
+    }
+
+    if (!data.instances.empty()) {
+        std::vector<Aabb> instanceBounds(data.instances.size());
+        for (int i = 0; i < data.instances.size(); i++) {
+            instanceBounds[i] = getInstanceBounds(data, i);
+        }
+
+        std::vector<internal::BvhNode> instanceBvhNodes = rt::buildBvh(instanceBounds, order);
+        std::vector<internal::Instance> orderedInstances(data.instances.size());
+        std::vector<uint32_t> orderedInstanceMeshes(data.instances.size());
+        std::vector<glm::mat4> orderedInstanceTransforms(data.instances.size());
+        for (int i = 0; i < order.size(); i++) {
+            orderedInstances[i] = data.instances[order[i]];
+            orderedInstanceMeshes[i] = data.instanceMeshes[order[i]];
+            orderedInstanceTransforms[i] = data.instanceTransforms[order[i]];
+            orderedInstances[i].bvhRoot = data.instancedMeshes[orderedInstanceMeshes[i]].bvhRoot;
+        }
+        data.instances = std::move(orderedInstances);
+        data.instanceMeshes = std::move(orderedInstanceMeshes);
+        data.instanceTransforms = std::move(orderedInstanceTransforms);
+        data.instanceBvhRoot = appendBvh(data.bvhNodes, instanceBvhNodes);
+    }
+
+    printf(
+        "INFO: Built bvh with %d nodes for %d spheres, %d triangles and %d instances of %d meshes\n",
+        (int) data.bvhNodes.size(), (int) data.spheres.size(), (int) data.numSceneTriangles,
+        (int) data.instances.size(), (int) data.instancedMeshes.size()
+    );
+}
+
+
+static float getLuminance(const cl_float3& color) {
+    return 0.2126f * color.s[0] + 0.7152f * color.s[1] + 0.0722f * color.s[2];
+}
+
+
+// whether primitives with the material go into the emitter list
+static bool isEmissive(const internal::Material& material) {
+    return getLuminance(material.emissionColor) > 0.0f;
+}
+
+
+// Gathers the spheres and triangles with an emissive material into `data.emitters`, with the cdf of their power
+// (the luminance of the emission times the area), the triangles of instances are transformed to world space
+static void buildEmitters(SceneData& data) {
+    data.emitters.clear();
+    data.emitterPower = 0.0f;
+
+    auto addEmitter = [&](glm::vec3 v0, glm::vec3 edge1, glm::vec3 edge2, const cl_float3& emission, float area, bool isSphere) {
+        if (area <= 0.0f) {
+            return;
+        }
+        data.emitterPower += getLuminance(emission) * area;
+        data.emitters.push_back({
+            {v0.x, v0.y, v0.z, 1.0f}, {edge1.x, edge1.y, edge1.z, 0.0f}, {edge2.x, edge2.y, edge2.z, 0.0f},
+            emission, data.emitterPower, isSphere
+        });
+    };
+    auto addTriangle = [&](glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, const cl_float3& emission) {
+        float area = 0.5f * glm::length(glm::cross(v1 - v0, v2 - v0));
+        addEmitter(v0, v1 - v0, v2 - v0, emission, area, false);
+    };
+    auto isEmissive = [&](uint32_t materialIndex) {
+        return rt::isEmissive(data.materials[materialIndex]);
+    };
+
+    for (const internal::Sphere& sphere : data.spheres) {
+        if (isEmissive(sphere.materialIndex)) {
+            float area = 4.0f * glm::pi<float>() * sphere.radius * sphere.radius;
+            addEmitter(toVec3(sphere.position), {sphere.radius, 0.0f, 0.0f}, glm::vec3(0.0f), data.materials[sphere.materialIndex].emissionColor, area, true);
+        }
+    }
+    for (uint32_t i = 0; i < data.numSceneTriangles; i++) {
+        const internal::TriangleIndices& triangle = data.triangles[i];
+        if (isEmissive(triangle.materialIndex)) {
+            addTriangle(toVec3(data.vertices[triangle.v0]), toVec3(data.vertices[triangle.v1]), toVec3(data.vertices[triangle.v2]), data.materials[triangle.materialIndex].emissionColor);
+        }
+    }
+
+    // most instanced meshes aren't emissive, they are only checked once
+    std::vector<bool> emissiveMeshes(data.instancedMeshes.size());
+    for (int meshIdx = 0; meshIdx < data.instancedMeshes.size(); meshIdx++) {
+        const InstancedMesh& mesh = data.instancedMeshes[meshIdx];
+        for (uint32_t i = mesh.firstTriangle; i < mesh.firstTriangle + mesh.numTriangles && !emissiveMeshes[meshIdx]; i++) {
+            emissiveMeshes[meshIdx] = isEmissive(data.triangles[i].materialIndex);
+        }
+    }
+    for (int instanceIdx = 0; instanceIdx < data.instances.size(); instanceIdx++) {
+        uint32_t materialIndex = data.instances[instanceIdx].materialIndex;
+        bool ownMaterial = materialIndex != RT_INSTANCE_MESH_MATERIAL;
+        uint32_t meshIdx = data.instanceMeshes[instanceIdx];
+        if (ownMaterial ? !isEmissive(materialIndex) : !emissiveMeshes[meshIdx]) {
+            continue;
+        }
+
+        const InstancedMesh& mesh = data.instancedMeshes[meshIdx];
+        const glm::mat4& transform = data.instanceTransforms[instanceIdx];
+        auto toWorld = [&](uint32_t vertexIdx) { return glm::vec3(transform * glm::vec4(toVec3(data.vertices[vertexIdx]), 1.0f)); };
+        for (uint32_t i = mesh.firstTriangle; i < mesh.firstTriangle + mesh.numTriangles; i++) {
+            const internal::TriangleIndices& triangle = data.triangles[i];
+            uint32_t triangleMaterial = ownMaterial ? materialIndex : triangle.materialIndex;
+            if (isEmissive(triangleMaterial)) {
+                addTriangle(toWorld(triangle.v0), toWorld(triangle.v1), toWorld(triangle.v2), data.materials[triangleMaterial].emissionColor);
+            }
+        }
+    }
+
+    for (internal::Emitter& emitter : data.emitters) {
+        emitter.cdf /= data.emitterPower;
+    }
+    if (!data.emitters.empty()) {
+        data.emitters.back().cdf = 1.0f;
+    }
+}
+
+
+// Spheres and triangles go into separate arrays, triangles as indices into a vertex array
+// mesh triangles are appended to the triangle array, their vertices (and normals) are copied as is
+// if `editable` is false, equal scene vertices are stored once and equal materials (by value) are merged
+// otherwise every scene triangle gets its own 3 consecutive vertices and only the same material pointers are merged,
+// so that each object and material can be changed on its own
+// if `buildBvh` is false, the primitives are tested linearly by the kernel
+// instanced meshes are stored once, after the scene triangles, and always get a bvh
+// the emissive primitives are also listed in `emitters` (see `buildEmitters`)
+static SceneData buildSceneData(const Scene& scene, bool buildBvh = true, bool editable = false) {
+    SceneData out;
+    out.backgroundColor = scene.backgroundColor;
+
+    // index in `out.instancedMeshes` of every mesh, -1 for the ones drawn directly
+    std::vector<int> instancedMeshIndices(scene.meshes.size(), -1);
+    std::vector<bool> validMeshes(scene.meshes.size());
+    for (int meshIdx = 0; meshIdx < scene.meshes.size(); meshIdx++) {
+        validMeshes[meshIdx] = isValid(scene.meshes[meshIdx]);
+    }
+    std::vector<const MeshInstance*> instances;
+    for (const MeshInstance& instance : scene.instances) {
+        if (instance.meshIndex >= scene.meshes.size()) {
+            printf("ERROR (`rt::buildSceneData`): Instance of mesh %u, the scene only has %d meshes\n", instance.meshIndex, (int) scene.meshes.size());
+            continue;
+        }
+        const Mesh& mesh = scene.meshes[instance.meshIndex];
+        if (!validMeshes[instance.meshIndex] || mesh.indices.empty()) {
+            continue;
+        }
+        if (instancedMeshIndices[instance.meshIndex] < 0) {
+            instancedMeshIndices[instance.meshIndex] = out.instancedMeshes.size();
+            out.instancedMeshes.push_back({0, (uint32_t) mesh.indices.size() / 3, 0});
+        }
+        instances.push_back(&instance);
+    }
+    if (!instances.empty() && !buildBvh) {
+        printf("WARN (`rt::buildSceneData`): Instances are traced through a bvh, building it anyway\n");
+        buildBvh = true;
+    }
+
     // 1. Grouping common materials
-    std::vector<std::shared_ptr<internal::Material>> uniqueMaterials;
+    // by value with a hash map, or by pointer if `editable`
     std::vector<uint32_t> materialIndices(scene.objects.size());
+    std::vector<uint32_t> meshMaterialIndices(scene.meshes.size());
     {
-        auto findMaterial = [&](std::shared_ptr<internal::Material> mat) {
-            return std::find(uniqueMaterials.begin(), uniqueMaterials.end(), mat);
+        auto materialHash = [](const internal::Material& mat) {
+            float values[7] = {
+                mat.color.s[0], mat.color.s[1], mat.color.s[2],
+                mat.emissionColor.s[0], mat.emissionColor.s[1], mat.emissionColor.s[2],
+                mat.smoothness
+            };
+            size_t hash = 0;
+            for (float value : values) {
+                // -0 and +0 compare equal, so they have to hash alike
+                if (value == 0.0f) {
+                    value = 0.0f;
+                }
+                uint32_t bits;
+                memcpy(&bits, &value, sizeof(bits));
+                hash = hash * 31 + bits;
+            }
+            return hash;
+        };
+        auto materialEqual = [](const internal::Material& a, const internal::Material& b) {
+            for (int i = 0; i < 3; i++) {
+                if (a.color.s[i] != b.color.s[i] || a.emissionColor.s[i] != b.emissionColor.s[i]) {
+                    return false;
+                }
+            }
+            return a.smoothness == b.smoothness;
+        };
+        std::unordered_map<internal::Material, uint32_t, decltype(materialHash), decltype(materialEqual)> valueIndices(0, materialHash, materialEqual);
+
+        // scenes usually reuse a few material pointers, a small cache by pointer skips most of the value lookups
+        struct CachedMaterial {
+            const internal::Material* material = nullptr;
+            uint32_t index = 0;
+        };
+        CachedMaterial cache[RT_MATERIAL_CACHE_SIZE];
+        auto getMaterialIndex = [&](const std::shared_ptr<internal::Material>& mat) {
+            CachedMaterial& cached = cache[((uintptr_t) mat.get() / sizeof(internal::Material)) % RT_MATERIAL_CACHE_SIZE];
+            if (cached.material == mat.get()) {
+                return cached.index;
+            }
+
+            uint32_t index = editable
+                ? out.materialIndices.try_emplace(mat, (uint32_t) out.materials.size()).first->second
+                : valueIndices.try_emplace(*mat, (uint32_t) out.materials.size()).first->second;
+            if (index == out.materials.size()) {
+                out.materials.push_back(*mat);
+            }
+
+            cached = {mat.get(), index};
+            return index;
         };
 
         for (int objIdx = 0; objIdx < scene.objects.size(); objIdx++) {
-            std::shared_ptr<internal::Material> mat = scene.objects[objIdx].material;
-            auto matLocation = findMaterial(mat);
-
-            if (matLocation == uniqueMaterials.end()) {
-                uniqueMaterials.push_back(mat);
-                materialIndices[objIdx] = uniqueMaterials.size() - 1;
-            } else {
-                materialIndices[objIdx] = matLocation - uniqueMaterials.begin();
+            materialIndices[objIdx] = getMaterialIndex(scene.objects[objIdx].material);
+        }
+        for (int meshIdx = 0; meshIdx < scene.meshes.size(); meshIdx++) {
+            meshMaterialIndices[meshIdx] = getMaterialIndex(scene.meshes[meshIdx].material);
+        }
+
+        out.instances.resize(instances.size());
+        out.instanceMeshes.resize(instances.size());
+        out.instanceTransforms.resize(instances.size());
+        for (int i = 0; i < instances.size(); i++) {
+            const MeshInstance& instance = *instances[i];
+            // rows of the inverse, the last one (0, 0, 0, 1) is left out
+            glm::mat4 worldToObject = glm::inverse(instance.transform);
+            for (int row = 0; row < 3; row++) {
+                out.instances[i].worldToObject[row] = {worldToObject[0][row], worldToObject[1][row], worldToObject[2][row], worldToObject[3][row]};
             }
+            out.instances[i].bvhRoot = 0;
+            out.instances[i].materialIndex = instance.material ? getMaterialIndex(instance.material) : RT_INSTANCE_MESH_MATERIAL;
+            out.instanceMeshes[i] = instancedMeshIndices[instance.meshIndex];
+            out.instanceTransforms[i] = instance.transform;
         }
     }
 
-    // 2. Creating scene buffers
-    int err;
-    uint32_t objectsBufferSize = scene.objects.size() * sizeof(internal::Object);
-    uint32_t materialsBufferSize = uniqueMaterials.size() * sizeof(internal::Material);
-    uint32_t sceneBufferSize = objectsBufferSize + materialsBufferSize;
-    cl::Buffer objectsBuffer = cl::Buffer(clContext, CL_MEM_READ_ONLY, objectsBufferSize, nullptr, &err);
-    cl::Buffer materialsBuffer = cl::Buffer(clContext, CL_MEM_READ_ONLY, materialsBufferSize, nullptr, &err);
+    // 2. Splitting the objects into a compact array per primitive type
+    // the slot of every object is known upfront, so the arrays are filled in parallel
+    std::vector<internal::Sphere>& spheres = out.spheres;
+    std::vector<cl_float3>& vertices = out.vertices;
+    std::vector<internal::TriangleIndices>& triangles = out.triangles;
+    {
+        uint32_t numSpheres = 0, numTriangles = 0;
+        out.objectSlots.resize(scene.objects.size());
+        for (int objIdx = 0; objIdx < scene.objects.size(); objIdx++) {
+            bool isSphere = std::holds_alternative<internal::Sphere>(scene.objects[objIdx].internal);
+            out.objectSlots[objIdx] = isSphere ? numSpheres++ : numTriangles++;
+        }
 
-    if (err) {
-        printf("ERROR: Unable to allocate buffers for [size: %.3f KB]\n", (float) sceneBufferSize / 1024);
-        internal::Scene scene;
-        scene.extra.numObjects = 0;
-        scene.extra.backgroundColor = {1.0f, 0.0f, 0.0f, 1.0f};
-        return scene;
+        spheres.resize(numSpheres);
+        triangles.resize(numTriangles);
+        vertices.resize(numTriangles * 3);
+        parallelFor(scene.objects.size(), [&](size_t first, size_t last) {
+            for (size_t objIdx = first; objIdx < last; objIdx++) {
+                const Object& object = scene.objects[objIdx];
+                uint32_t slot = out.objectSlots[objIdx];
+                if (auto sphere = std::get_if<internal::Sphere>(&object.internal)) {
+                    spheres[slot] = *sphere;
+                    spheres[slot].materialIndex = materialIndices[objIdx];
+                } else if (auto triangle = std::get_if<internal::Triangle>(&object.internal)) {
+                    vertices[slot * 3 + 0] = triangle->v0;
+                    vertices[slot * 3 + 1] = triangle->v1;
+                    vertices[slot * 3 + 2] = triangle->v2;
+                    triangles[slot] = {slot * 3 + 0, slot * 3 + 1, slot * 3 + 2, materialIndices[objIdx]};
+                }
+            }
+        });
+    }
+
+    // equal triangle vertices are stored once, in the order they first appear
+    if (!editable && !triangles.empty()) {
+        auto vertexHash = [](const cl_float3& v) {
+            // -0 and +0 compare equal, so they have to hash alike
+            float values[3];
+            for (int i = 0; i < 3; i++) {
+                values[i] = v.s[i] == 0.0f ? 0.0f : v.s[i];
+            }
+            uint32_t bits[3];
+            memcpy(bits, values, sizeof(bits));
+            return (size_t) bits[0] * 73856093 ^ (size_t) bits[1] * 19349663 ^ (size_t) bits[2] * 83492791;
+        };
+        auto vertexEqual = [](const cl_float3& a, const cl_float3& b) {
+            return a.s[0] == b.s[0] && a.s[1] == b.s[1] && a.s[2] == b.s[2];
+        };
+        std::unordered_map<cl_float3, uint32_t, decltype(vertexHash), decltype(vertexEqual)> vertexIndices(vertices.size(), vertexHash, vertexEqual);
+
+        std::vector<uint32_t> remap(vertices.size());
+        uint32_t numVertices = 0;
+        for (uint32_t i = 0; i < vertices.size(); i++) {
+            auto [it, inserted] = vertexIndices.try_emplace(vertices[i], numVertices);
+            if (inserted) {
+                vertices[numVertices++] = vertices[i];
+            }
+            remap[i] = it->second;
+        }
+        vertices.resize(numVertices);
+
+        parallelFor(triangles.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                triangles[i].v0 = remap[triangles[i].v0];
+                triangles[i].v1 = remap[triangles[i].v1];
+                triangles[i].v2 = remap[triangles[i].v2];
+            }
+        });
     }
 
-    printf("INFO: Allocated buffers for [size %.3f KB]\n", (float) sceneBufferSize / 1024);
+    // normals are only stored if a mesh has them, vertices without one get a zero normal (flat shaded)
+    std::vector<cl_float3>& normals = out.normals;
+    bool hasNormals = std::any_of(scene.meshes.begin(), scene.meshes.end(), [](const Mesh& mesh) { return !mesh.normals.empty(); });
+    if (hasNormals) {
+        normals.resize(vertices.size(), {0.0f, 0.0f, 0.0f, 0.0f});
+    }
 
-    std::vector<internal::Object> internalObjects(scene.objects.size());
-    std::vector<internal::Material> materials(uniqueMaterials.size());
-    for (int i = 0; i < scene.objects.size(); i++) {
-        internalObjects[i] = convert(scene.objects[i]);
-        internalObjects[i].materialIndex = materialIndices[i];
+    auto appendMesh = [&](int meshIdx) {
+        const Mesh& mesh = scene.meshes[meshIdx];
+        uint32_t firstVertex = vertices.size();
+        uint32_t firstTriangle = triangles.size();
+        vertices.resize(firstVertex + mesh.vertices.size());
+        if (hasNormals) {
+            normals.resize(vertices.size());
+        }
+        parallelFor(mesh.vertices.size(), [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                const glm::vec3& v = mesh.vertices[i];
+                vertices[firstVertex + i] = {v.x, v.y, v.z, 1.0f};
+                if (hasNormals) {
+                    glm::vec3 n = mesh.normals.empty() ? glm::vec3(0.0f) : mesh.normals[i];
+                    normals[firstVertex + i] = {n.x, n.y, n.z, 0.0f};
+                }
+            }
+        });
+
+        triangles.resize(firstTriangle + mesh.indices.size() / 3);
+        parallelFor(mesh.indices.size() / 3, [&](size_t first, size_t last) {
+            for (size_t i = first; i < last; i++) {
+                internal::TriangleIndices triangle = {
+                    firstVertex + mesh.indices[i * 3 + 0],
+                    firstVertex + mesh.indices[i * 3 + 1],
+                    firstVertex + mesh.indices[i * 3 + 2],
+                    meshMaterialIndices[meshIdx]
+                };
+                triangles[firstTriangle + i] = triangle;
+            }
+        });
+    };
+
+    // the meshes drawn directly are part of the scene triangles, the instanced ones come after them
+    for (int meshIdx = 0; meshIdx < scene.meshes.size(); meshIdx++) {
+        if (validMeshes[meshIdx] && instancedMeshIndices[meshIdx] < 0) {
+            appendMesh(meshIdx);
+        }
     }
-    for (int i = 0; i < materials.size(); i++) {
-        materials[i] = *uniqueMaterials[i];
+    out.numSceneTriangles = triangles.size();
+    for (int meshIdx = 0; meshIdx < scene.meshes.size(); meshIdx++) {
+        if (instancedMeshIndices[meshIdx] >= 0) {
+            out.instancedMeshes[instancedMeshIndices[meshIdx]].firstTriangle = triangles.size();
+            appendMesh(meshIdx);
+        }
+    }
+
+    // 3. Building a bvh per primitive type, stored one after the other
+    if (buildBvh) {
+        std::vector<uint32_t> sphereSlots, triangleSlots;
+        buildSceneBvh(out, sphereSlots, triangleSlots);
+        for (int objIdx = 0; objIdx < scene.objects.size(); objIdx++) {
+            bool isSphere = std::holds_alternative<internal::Sphere>(scene.objects[objIdx].internal);
+            out.objectSlots[objIdx] = (isSphere ? sphereSlots : triangleSlots)[out.objectSlots[objIdx]];
+        }
     }
-    clQueue.enqueueWriteBuffer(objectsBuffer, true, 0, objectsBufferSize, internalObjects.data());
-    clQueue.enqueueWriteBuffer(materialsBuffer, true, 0, materialsBufferSize, materials.data());
+
+    buildEmitters(out);
+    return out;
+}
+
+
+static internal::SceneExtra getSceneExtra(const SceneData& data) {
+    internal::SceneExtra extra;
+    extra.numSpheres = data.spheres.size();
+    extra.numTriangles = data.numSceneTriangles;
+    extra.numBvhNodes = data.bvhNodes.size();
+    extra.triangleBvhRoot = data.triangleBvhRoot;
+    extra.numInstances = data.instances.size();
+    extra.instanceBvhRoot = data.instanceBvhRoot;
+    extra.numEmitters = data.emitters.size();
+    extra.emitterPdfScale = data.emitterPower > 0.0f ? 1.0f / data.emitterPower : 0.0f;
+    extra.backgroundColor = {data.backgroundColor.r, data.backgroundColor.g, data.backgroundColor.b, 1.0f};
+    return extra;
+}
+
+
+// Uploads `data` into new buffers, skipping the empty ones
+static internal::Scene upload(const SceneData& data, cl::Context clContext, cl::CommandQueue clQueue) {
+    uint32_t spheresBufferSize = data.spheres.size() * sizeof(internal::Sphere);
+    uint32_t verticesBufferSize = data.vertices.size() * sizeof(cl_float3);
+    uint32_t normalsBufferSize = data.normals.size() * sizeof(cl_float3);
+    uint32_t trianglesBufferSize = data.triangles.size() * sizeof(internal::TriangleIndices);
+    uint32_t materialsBufferSize = data.materials.size() * sizeof(internal::Material);
+    uint32_t bvhNodesBufferSize = data.bvhNodes.size() * sizeof(internal::BvhNode);
+    uint32_t instancesBufferSize = data.instances.size() * sizeof(internal::Instance);
+    uint32_t emittersBufferSize = data.emitters.size() * sizeof(internal::Emitter);
+    uint32_t sceneBufferSize = spheresBufferSize + verticesBufferSize + normalsBufferSize + trianglesBufferSize + materialsBufferSize + bvhNodesBufferSize + instancesBufferSize + emittersBufferSize;
+
+    bool allocationFailed = false;
+    auto createBuffer = [&](const void* data, uint32_t size) {
+        if (size == 0) {
+            return cl::Buffer();
+        }
+        int err = 0;
+        cl::Buffer buffer = cl::Buffer(clContext, CL_MEM_READ_ONLY, size, nullptr, &err);
+        if (err) {
+            allocationFailed = true;
+            return cl::Buffer();
+        }
+        clQueue.enqueueWriteBuffer(buffer, true, 0, size, data);
+        return buffer;
+    };
 
     internal::Scene out;
-    out.objectsBuffer = objectsBuffer;
-    out.materialsBuffer = materialsBuffer;
-    out.extra.numObjects = scene.objects.size();
-    out.extra.backgroundColor = {scene.backgroundColor.r, scene.backgroundColor.g, scene.backgroundColor.b, 1.0f};
+    out.spheresBuffer = createBuffer(data.spheres.data(), spheresBufferSize);
+    out.verticesBuffer = createBuffer(data.vertices.data(), verticesBufferSize);
+    out.normalsBuffer = createBuffer(data.normals.data(), normalsBufferSize);
+    out.trianglesBuffer = createBuffer(data.triangles.data(), trianglesBufferSize);
+    out.materialsBuffer = createBuffer(data.materials.data(), materialsBufferSize);
+    out.bvhNodesBuffer = createBuffer(data.bvhNodes.data(), bvhNodesBufferSize);
+    out.instancesBuffer = createBuffer(data.instances.data(), instancesBufferSize);
+    out.emittersBuffer = createBuffer(data.emitters.data(), emittersBufferSize);
+
+    if (allocationFailed) {
+        printf("ERROR: Unable to allocate buffers for [size: %.3f KB]\n", (float) sceneBufferSize / 1024);
+        internal::Scene scene;
+        scene.extra.numSpheres = 0;
+        scene.extra.numTriangles = 0;
+        scene.extra.numBvhNodes = 0;
+        scene.extra.triangleBvhRoot = 0;
+        scene.extra.numInstances = 0;
+        scene.extra.instanceBvhRoot = 0;
+        scene.extra.numEmitters = 0;
+        scene.extra.emitterPdfScale = 0.0f;
+        scene.extra.backgroundColor = {1.0f, 0.0f, 0.0f, 1.0f};
+        return scene;
+    }
+
+    printf(
+        "INFO: Allocated buffers for [size %.3f KB] (spheres: %.3f KB, vertices: %.3f KB, normals: %.3f KB, triangles: %.3f KB, bvh: %.3f KB, instances: %.3f KB, emitters: %.3f KB)\n",
+        (float) sceneBufferSize / 1024, (float) spheresBufferSize / 1024, (float) verticesBufferSize / 1024,
+        (float) normalsBufferSize / 1024, (float) trianglesBufferSize / 1024, (float) bvhNodesBufferSize / 1024,
+        (float) instancesBufferSize / 1024, (float) emittersBufferSize / 1024
+    );
+
+    out.extra = getSceneExtra(data);
     return out;
 }
 
+
+static internal::Scene convert(const Scene& scene, cl::Context clContext, cl::CommandQueue clQueue, bool buildBvh = true) {
+    return upload(buildSceneData(scene, buildBvh), clContext, clQueue);
+}
+
 }
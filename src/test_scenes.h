@@ -2,6 +2,8 @@
 #pragma once
 
 #include "src/raytracer/scene.h"
+#include <glm/gtc/matrix_transform.hpp>
+#include <random>
 
 
 rt::Scene createScene_1() {
@@ -181,6 +183,132 @@ rt::Scene createScene_8() {
 }
 
 
+// latitude/longitude sphere, with per-vertex normals if `smooth`
+rt::Mesh createUvSphereMesh(const glm::vec3& center, float radius, int rings, int segments, bool smooth, std::shared_ptr<rt::internal::Material> material) {
+    std::vector<glm::vec3> vertices;
+    std::vector<glm::vec3> normals;
+    std::vector<uint32_t> indices;
+
+    for (int ring = 0; ring <= rings; ring++) {
+        float theta = 3.14159265f * ring / rings;
+        for (int segment = 0; segment <= segments; segment++) {
+            float phi = 2.0f * 3.14159265f * segment / segments;
+            glm::vec3 normal = {std::sin(theta) * std::cos(phi), std::cos(theta), std::sin(theta) * std::sin(phi)};
+            vertices.push_back(center + normal * radius);
+            normals.push_back(normal);
+        }
+    }
+
+    for (int ring = 0; ring < rings; ring++) {
+        for (int segment = 0; segment < segments; segment++) {
+            uint32_t i0 = ring * (segments + 1) + segment;
+            uint32_t i1 = i0 + segments + 1;
+            indices.insert(indices.end(), {i0, i1, i0 + 1, i0 + 1, i1, i1 + 1});
+        }
+    }
+
+    return rt::createMesh(std::move(vertices), std::move(indices), material, smooth ? std::move(normals) : std::vector<glm::vec3>());
+}
+
+
+rt::Scene createScene_9() {
+    auto redMat = rt::createMaterial({0.8f, 0.2f, 0.2f}, 0.0f);
+    auto mirrorMat = rt::createMaterial({0.8f, 0.8f, 0.8f}, 0.95f);
+    auto groundMat = rt::createMaterial({0.3f, 0.3f, 0.3f}, 0.0f);
+    auto lightMat = rt::createEmissiveMaterial({1.0f, 0.9f, 0.8f}, 20.0f);
+
+    rt::Scene scene;
+
+    scene.meshes.push_back(createUvSphereMesh({-1.2f, 0.0f, 0.0f}, 1.0f, 16, 32, true, redMat));
+    scene.meshes.push_back(createUvSphereMesh({1.2f, 0.0f, 0.0f}, 1.0f, 16, 32, false, mirrorMat));
+    scene.objects.push_back(rt::createSphere({0.0f, -101.0f, 0.0f}, 100.0f, groundMat));
+    scene.objects.push_back(rt::createSphere({0.0f, 12.0f, 4.0f}, 6.0f, lightMat));
+
+    scene.backgroundColor = {0.1f, 0.1f, 0.15f};
+
+    return scene;
+}
+
+
+// a grid of instances of one mesh, scaled and rotated at random, every fourth one with its own material
+rt::Scene createScene_10() {
+    auto greenMat = rt::createMaterial({0.2f, 0.6f, 0.2f}, 0.0f);
+    auto goldMat = rt::createMaterial({0.9f, 0.7f, 0.2f}, 0.8f);
+    auto groundMat = rt::createMaterial({0.4f, 0.3f, 0.2f}, 0.0f);
+    auto lightMat = rt::createEmissiveMaterial({1.0f, 0.9f, 0.8f}, 20.0f);
+
+    rt::Scene scene;
+
+    scene.meshes.push_back(createUvSphereMesh({0.0f, 1.0f, 0.0f}, 1.0f, 16, 32, true, greenMat));
+    scene.objects.push_back(rt::createSphere({0.0f, -1000.0f, 0.0f}, 1000.0f, groundMat));
+    scene.objects.push_back(rt::createSphere({0.0f, 40.0f, 10.0f}, 15.0f, lightMat));
+
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+    const int gridSize = 20;
+    for (int z = 0; z < gridSize; z++) {
+        for (int x = 0; x < gridSize; x++) {
+            glm::vec3 position = {(x - gridSize / 2) * 3.0f + unit(rng), 0.0f, -z * 3.0f + unit(rng)};
+            glm::mat4 transform = glm::translate(glm::mat4(1.0f), position);
+            transform = glm::rotate(transform, unit(rng) * 6.2831853f, glm::vec3(0.0f, 1.0f, 0.0f));
+            transform = glm::scale(transform, glm::vec3(0.6f + unit(rng) * 0.4f, 0.8f + unit(rng) * 1.2f, 0.6f + unit(rng) * 0.4f));
+            scene.instances.push_back(rt::createMeshInstance(0, transform, (x + z) % 4 == 0 ? goldMat : nullptr));
+        }
+    }
+
+    scene.backgroundColor = {0.5f, 0.7f, 1.0f};
+
+    return scene;
+}
+
+
+// `count` small randomly oriented triangles scattered in a box, used for benchmarking
+rt::Scene createScene_triangleSoup(int count, uint32_t seed = 1) {
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> position(-3.0f, 3.0f);
+    std::uniform_real_distribution<float> offset(-0.15f, 0.15f);
+    std::uniform_real_distribution<float> unit(0.0f, 1.0f);
+
+    std::shared_ptr<rt::internal::Material> materials[] = {
+        rt::createMaterial({0.8f, 0.3f, 0.3f}, 0.0f),
+        rt::createMaterial({0.3f, 0.8f, 0.3f}, 0.5f),
+        rt::createMaterial({0.3f, 0.3f, 0.8f}, 0.9f),
+    };
+
+    rt::Scene scene;
+    scene.objects.reserve(count);
+
+    for (int i = 0; i < count; i++) {
+        glm::vec3 center = {position(rng), position(rng), position(rng)};
+        glm::vec3 v0 = center + glm::vec3(offset(rng), offset(rng), offset(rng));
+        glm::vec3 v1 = center + glm::vec3(offset(rng), offset(rng), offset(rng));
+        glm::vec3 v2 = center + glm::vec3(offset(rng), offset(rng), offset(rng));
+        scene.objects.push_back(rt::createTriangle(v0, v1, v2, materials[(int) (unit(rng) * 2.999f)]));
+    }
+    scene.backgroundColor = {0.6f, 0.7f, 0.9f};
+
+    return scene;
+}
+
+
+// `gridSize` x `gridSize` spheres on the z = 0 plane, used for benchmarking
+rt::Scene createScene_sphereGrid(int gridSize) {
+    auto material = rt::createMaterial({0.7f, 0.3f, 0.3f}, 0.0f);
+
+    rt::Scene scene;
+    scene.backgroundColor = {0.5f, 0.7f, 1.0f};
+    scene.objects.reserve(gridSize * gridSize);
+    float spacing = 6.0f / gridSize;
+    for (int y = 0; y < gridSize; y++) {
+        for (int x = 0; x < gridSize; x++) {
+            glm::vec3 position = {-3.0f + (x + 0.5f) * spacing, -3.0f + (y + 0.5f) * spacing, 0.0f};
+            scene.objects.push_back(rt::createSphere(position, spacing * 0.4f, material));
+        }
+    }
+    return scene;
+}
+
+
 std::vector<rt::internal::Scene> createAllScenes(cl::Context context, cl::CommandQueue queue) {
     std::vector<rt::Scene> scenes = {
         createScene_1(),
@@ -191,6 +319,8 @@ std::vector<rt::internal::Scene> createAllScenes(cl::Context context, cl::Comman
         createScene_6(),
         createScene_7(),
         createScene_8(),
+        createScene_9(),
+        createScene_10(),
     };
     std::vector<rt::internal::Scene> res;
     for (const auto& scene : scenes) {